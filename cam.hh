@@ -0,0 +1,465 @@
+#ifndef __CAM_HH__
+#define __CAM_HH__
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "intmath.hh"
+#include "page_buffer.hh"
+#include "probe.hh"
+#include "reg_class.hh"
+#include "replacement_policies.hh"
+
+namespace workflow
+{
+
+using Addr = uint64_t;
+
+/**
+ * Mix a 64-bit address into a well distributed 64-bit hash
+ * (splitmix64 finalizer). Addresses are sparse and often aligned, so the
+ * low bits alone make for a poor bucket index.
+ */
+inline uint64_t
+hashAddr(Addr addr)
+{
+    uint64_t x = addr + 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+/** Outcome of a CAM insertion. */
+struct CAMInsertResult
+{
+    enum Status
+    {
+        Inserted,   ///< new key added
+        Updated,    ///< key was present, value replaced
+        Evicted,    ///< key added, but another entry was pushed out
+        Full        ///< no room for the key, nothing changed
+    };
+
+    Status status;
+    /** The entry pushed out of the CAM when status is Evicted. */
+    Addr evictedKey = 0;
+    RegIdPtr evictedValue = nullptr;
+
+    /** True iff the requested key is now held by the CAM. */
+    bool ok() const { return status != Full; }
+};
+
+/**
+ * Content addressable memory mapping (sparse) 64-bit addresses to
+ * architectural registers.
+ *
+ * The table is a bucketized cuckoo hash: every key lives in one of two
+ * candidate buckets of BucketWays slots each, so a lookup inspects at most
+ * two buckets (two cache lines) regardless of occupancy. Insertion
+ * displaces residents along a random walk bounded by maxKicks; when the
+ * walk does not terminate it is undone and the insertion fails as if the
+ * CAM were full, so no entry is ever dropped silently.
+ *
+ * Entries are kept in a dense array indexed by a stable entry id; the hash
+ * buckets only hold keys and ids, so displacement never moves values.
+ * Ids start at 1 so that an all-zero bucket is empty, which lets the
+ * buckets live in a lazily zeroed PageBuffer.
+ *
+ * By default a full CAM refuses new keys. With a replacement policy set,
+ * the policy picks a victim among all entries (ids form the ways of a
+ * single set) and the new key takes its place.
+ */
+class CAM
+{
+  public:
+    static constexpr unsigned BucketWays = 4;
+    static constexpr uint32_t InvalidId = 0;
+
+    /**
+     * Called with every entry pushed out of the CAM, so the owner can
+     * spill or release the register it maps to.
+     */
+    using EvictionCallback = std::function<void(Addr, RegIdPtr)>;
+
+  private:
+    struct alignas(64) Bucket
+    {
+        Addr keys[BucketWays];
+        uint32_t ids[BucketWays];
+    };
+
+    const size_t _maxSize;
+    const unsigned _maxKicks;
+
+    PageBuffer<Bucket> buckets;
+    size_t bucketMask;
+
+    /** Dense entry storage, indexed by entry id; entry 0 is unused. */
+    std::vector<Addr> entryKeys;
+    std::vector<RegIdPtr> entryValues;
+    /** Way of an entry for the replacement policy, and back. */
+    static unsigned wayOf(uint32_t id) { return id - 1; }
+    static uint32_t idOfWay(unsigned way) { return way + 1; }
+
+    /** Ids released by displacement failures, reused first. */
+    std::vector<uint32_t> freeIds;
+    /** Slots swapped by the current displacement walk, to undo it. */
+    std::vector<std::pair<size_t, unsigned>> walk;
+    size_t numEntries = 0;
+
+    /** Victim selection when full; nullptr refuses inserts instead. */
+    std::unique_ptr<ReplacementPolicy> replPolicy;
+    EvictionCallback evictionCallback;
+
+    /** State of the xorshift generator picking displacement victims. */
+    uint64_t rngState = 0x2545f4914f6cdd1dULL;
+
+    uint64_t nextRandom() { return xorshift64(rngState); }
+
+    size_t bucket1(uint64_t h) const { return h & bucketMask; }
+    size_t bucket2(uint64_t h) const { return (h >> 32) & bucketMask; }
+
+    size_t
+    otherBucket(Addr key, size_t b) const
+    {
+        const uint64_t h = hashAddr(key);
+        return b == bucket1(h) ? bucket2(h) : bucket1(h);
+    }
+
+    /** Locate the slot holding key, or return false. */
+    bool
+    locate(Addr key, size_t &bucket, unsigned &way) const
+    {
+        const uint64_t h = hashAddr(key);
+        const size_t cand[2] = { bucket1(h), bucket2(h) };
+        for (size_t b : cand) {
+            const Bucket &bkt = buckets[b];
+            for (unsigned w = 0; w < BucketWays; w++) {
+                if (bkt.ids[w] != InvalidId && bkt.keys[w] == key) {
+                    bucket = b;
+                    way = w;
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    /** Place (key, id) in a free slot of bucket b if there is one. */
+    bool
+    place(size_t b, Addr key, uint32_t id)
+    {
+        Bucket &bkt = buckets[b];
+        for (unsigned w = 0; w < BucketWays; w++) {
+            if (bkt.ids[w] == InvalidId) {
+                bkt.keys[w] = key;
+                bkt.ids[w] = id;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t
+    allocId()
+    {
+        if (!freeIds.empty()) {
+            uint32_t id = freeIds.back();
+            freeIds.pop_back();
+            return id;
+        }
+        entryKeys.push_back(0);
+        entryValues.push_back(nullptr);
+        return entryKeys.size() - 1;
+    }
+
+    /** Remove id's key from the hash table, returning its slot. */
+    void
+    removeId(uint32_t id, size_t &b, unsigned &w)
+    {
+        [[maybe_unused]] bool found = locate(entryKeys[id], b, w);
+        assert(found && buckets[b].ids[w] == id);
+        buckets[b].ids[w] = InvalidId;
+    }
+
+    /** Give back an id allocated for a key that found no slot. */
+    void
+    releaseId(uint32_t id)
+    {
+        freeIds.push_back(id);
+        numEntries--;
+    }
+
+    CAMInsertResult
+    evicted(uint32_t id)
+    {
+        if (evictionCallback)
+            evictionCallback(entryKeys[id], entryValues[id]);
+        return { CAMInsertResult::Evicted, entryKeys[id], entryValues[id] };
+    }
+
+    /**
+     * Insert (key, id) into the hash table.
+     * @return false, with the table as it was, if the displacement walk
+     * gives up.
+     */
+    bool
+    insertId(Addr key, uint32_t id)
+    {
+        const uint64_t h = hashAddr(key);
+        if (place(bucket1(h), key, id) || place(bucket2(h), key, id))
+            return true;
+
+        walk.clear();
+        size_t b = (nextRandom() & 1) ? bucket1(h) : bucket2(h);
+        for (unsigned kick = 0; kick < _maxKicks; kick++) {
+            const unsigned w = nextRandom() % BucketWays;
+            std::swap(key, buckets[b].keys[w]);
+            std::swap(id, buckets[b].ids[w]);
+            walk.emplace_back(b, w);
+            b = otherBucket(key, b);
+            if (place(b, key, id))
+                return true;
+        }
+        // Swap back in reverse, ending with the original key in hand.
+        for (auto it = walk.rbegin(); it != walk.rend(); ++it) {
+            std::swap(key, buckets[it->first].keys[it->second]);
+            std::swap(id, buckets[it->first].ids[it->second]);
+        }
+        return false;
+    }
+
+  public:
+    /**
+     * @param max_size Maximum number of entries the CAM may hold.
+     * @param max_kicks Bound on the displacement walk of one insertion.
+     */
+    explicit CAM(size_t max_size = 512, unsigned max_kicks = 128)
+        : _maxSize(max_size), _maxKicks(max_kicks)
+    {
+        assert(max_size > 0 && max_size < UINT32_MAX);
+        // Keep the table at most half full; a 4-way cuckoo table only
+        // starts failing insertions well above 90% occupancy.
+        const size_t num_buckets =
+            nextPow2(std::max<size_t>(2,
+                        (2 * max_size + BucketWays - 1) / BucketWays));
+        buckets.reset(num_buckets);
+        bucketMask = num_buckets - 1;
+        entryKeys.reserve(max_size + 1);
+        entryValues.reserve(max_size + 1);
+        entryKeys.push_back(0);
+        entryValues.push_back(nullptr);
+        walk.reserve(max_kicks);
+    }
+
+    /**
+     * A CAM holding the (key, value) pairs of [first, last); see
+     * addRange() for the pairs that do not fit.
+     */
+    template <class InputIt>
+    CAM(InputIt first, InputIt last, size_t max_size,
+        unsigned max_kicks = 128)
+        : CAM(max_size, max_kicks)
+    {
+        addRange(first, last);
+    }
+
+    size_t getMaxSize() const { return _maxSize; }
+    size_t size() const { return numEntries; }
+
+    /**
+     * Remove every entry, keeping the allocated storage. Entries are not
+     * passed to the eviction callback.
+     */
+    void
+    clear()
+    {
+        buckets.zero();
+        entryKeys.resize(1);
+        entryValues.resize(1);
+        freeIds.clear();
+        numEntries = 0;
+    }
+
+    /** Replace entries chosen by the given policy once the CAM is full. */
+    void
+    setReplacementPolicy(ReplacementPolicyType type)
+    {
+        replPolicy = makeReplacementPolicy(type, 1, _maxSize);
+        // Entries already present count as filled in id order.
+        for (uint32_t id = 1; id < entryKeys.size(); id++)
+            replPolicy->reset(0, wayOf(id));
+        for (uint32_t id : freeIds)
+            replPolicy->invalidate(0, wayOf(id));
+    }
+
+    void
+    setEvictionCallback(EvictionCallback cb)
+    {
+        evictionCallback = std::move(cb);
+    }
+
+    /**
+     * Map key to value, replacing the current value if key is present.
+     * @return The outcome; see CAMInsertResult.
+     */
+    CAMInsertResult
+    add(Addr key, RegIdPtr value)
+    {
+        size_t b;
+        unsigned w;
+        if (locate(key, b, w)) {
+            const uint32_t id = buckets[b].ids[w];
+            entryValues[id] = value;
+            if (replPolicy)
+                replPolicy->touch(0, wayOf(id));
+            return { CAMInsertResult::Updated };
+        }
+
+        if (numEntries < _maxSize) {
+            const uint32_t id = allocId();
+            numEntries++;
+            if (!insertId(key, id)) {
+                releaseId(id);
+                return { CAMInsertResult::Full };
+            }
+            entryKeys[id] = key;
+            entryValues[id] = value;
+            if (replPolicy)
+                replPolicy->reset(0, wayOf(id));
+            return { CAMInsertResult::Inserted };
+        }
+        if (!replPolicy)
+            return { CAMInsertResult::Full };
+
+        // The victim's slot need not be one of key's buckets, so the walk
+        // can still fail; the victim then goes back where it was.
+        const uint32_t id = idOfWay(replPolicy->getVictim(0));
+        removeId(id, b, w);
+        if (!insertId(key, id)) {
+            buckets[b].ids[w] = id;
+            return { CAMInsertResult::Full };
+        }
+        CAMInsertResult result = evicted(id);
+        entryKeys[id] = key;
+        entryValues[id] = value;
+        replPolicy->reset(0, wayOf(id));
+        return result;
+    }
+
+    /**
+     * add() every (key, value) pair of [first, last), without building a
+     * CAMInsertResult per pair. Without a replacement policy, each pair
+     * hashes its key once and scans its two buckets once, both to find
+     * the key and to find a free slot.
+     * @return The pairs the CAM does not hold afterwards: those refused
+     * for lack of room and those evicted by the replacement policy.
+     * Evictions also go to the callback.
+     */
+    template <class InputIt>
+    std::vector<std::pair<Addr, RegIdPtr>>
+    addRange(InputIt first, InputIt last)
+    {
+        std::vector<std::pair<Addr, RegIdPtr>> left_out;
+        for (; first != last; ++first) {
+            const Addr key = first->first;
+            const RegIdPtr value = first->second;
+            if (replPolicy) {
+                CAMInsertResult res = add(key, value);
+                if (res.status == CAMInsertResult::Full)
+                    left_out.emplace_back(key, value);
+                else if (res.status == CAMInsertResult::Evicted)
+                    left_out.emplace_back(res.evictedKey, res.evictedValue);
+                continue;
+            }
+
+            const uint64_t h = hashAddr(key);
+            const size_t cand[2] = { bucket1(h), bucket2(h) };
+            Bucket *free_bkt = nullptr;
+            unsigned free_way = 0;
+            uint32_t found = InvalidId;
+            for (size_t b : cand) {
+                Bucket &bkt = buckets[b];
+                for (unsigned w = 0; w < BucketWays; w++) {
+                    const uint32_t id = bkt.ids[w];
+                    if (id != InvalidId && bkt.keys[w] == key) {
+                        found = id;
+                    } else if (id == InvalidId && !free_bkt) {
+                        free_bkt = &bkt;
+                        free_way = w;
+                    }
+                }
+            }
+            if (found != InvalidId) {
+                entryValues[found] = value;
+                continue;
+            }
+            if (numEntries == _maxSize) {
+                left_out.emplace_back(key, value);
+                continue;
+            }
+
+            const uint32_t id = allocId();
+            numEntries++;
+            if (free_bkt) {
+                free_bkt->keys[free_way] = key;
+                free_bkt->ids[free_way] = id;
+            } else if (!insertId(key, id)) {
+                releaseId(id);
+                left_out.emplace_back(key, value);
+                continue;
+            }
+            entryKeys[id] = key;
+            entryValues[id] = value;
+        }
+        return left_out;
+    }
+
+    void
+    loop() const
+    {
+        std::vector<std::pair<Addr, RegIdPtr>> contents;
+        contents.reserve(numEntries);
+        for (const Bucket &bkt : buckets) {
+            for (unsigned w = 0; w < BucketWays; w++) {
+                if (bkt.ids[w] != InvalidId)
+                    contents.emplace_back(bkt.keys[w],
+                                          entryValues[bkt.ids[w]]);
+            }
+        }
+        std::sort(contents.begin(), contents.end());
+
+        std::cout << "Displaying CAM contents now (KEY: VALUE)..."
+                  << std::endl;
+        for (const auto &kv : contents)
+            std::cout << kv.first << ": " << *kv.second << std::endl;
+    }
+
+    /**
+     * Given the key, find value; nullptr if the key is not present.
+     * A hit counts as an access for the replacement policy.
+     */
+    RegIdPtr
+    find(Addr key)
+    {
+        PROBE_SCOPE(CamFind);
+        size_t b;
+        unsigned w;
+        if (!locate(key, b, w))
+            return nullptr; // handle at the caller
+        const uint32_t id = buckets[b].ids[w];
+        if (replPolicy)
+            replPolicy->touch(0, wayOf(id));
+        return entryValues[id];
+    }
+};
+
+} // namespace workflow
+
+#endif // __CAM_HH__
@@ -0,0 +1,82 @@
+#ifndef __CAPABILITY_HH__
+#define __CAPABILITY_HH__
+
+#include <cstdint>
+
+namespace workflow
+{
+
+/**
+ * Capability layout: access rights in bits 0-7, L1 cache line number in
+ * bits 8-16 and cache level in bits 17-18.
+ */
+/** @{ */
+constexpr unsigned CapRightsBits = 8;
+constexpr unsigned CapLineShift = 8;
+constexpr unsigned CapLineBits = 9;
+constexpr unsigned CapLevelShift = 17;
+constexpr unsigned CapLevelBits = 2;
+/** @} */
+
+/** Access rights; the remaining bits of the rights field are reserved. */
+enum CapRights : uint32_t
+{
+    CapRead = 1 << 0,
+    CapWrite = 1 << 1,
+    CapAllRights = (1 << CapRightsBits) - 1
+};
+
+inline uint32_t
+getCacheLineNumber(uint32_t cap)
+{
+    // for l1 cache, max no. of cache blocks = 2^9 = 512.
+    return (cap >> CapLineShift) & ((1 << CapLineBits) - 1);
+}
+
+inline uint32_t
+getAccessRights(uint64_t cap)
+{
+    return cap & CapAllRights;
+}
+
+inline uint32_t
+getCacheLevel(uint64_t cap)
+{
+    return (cap >> CapLevelShift) & ((1 << CapLevelBits) - 1);
+}
+
+/* i is the cache line number */
+inline uint32_t
+constructCapability(int i)
+{
+    // assuming non-secure class of service
+    // and a first-level cache
+    uint32_t access_rights = 0b00011111;
+    uint32_t cache_level = 0b01;
+    return cache_level << 17 | (i << 8 | access_rights);
+}
+
+/** Rights and cache levels an access requires of a capability. */
+struct CapAccessMask
+{
+    uint32_t rights;
+    /** Bit n set if cache level n is acceptable. */
+    uint32_t levels;
+};
+
+/**
+ * 1 if cap lacks any of the rights in mask or names a cache level the
+ * mask does not accept, else 0. Branch free, so the cost does not depend
+ * on the outcome.
+ */
+inline uint32_t
+capFault(uint64_t cap, const CapAccessMask &mask)
+{
+    const uint32_t missing = mask.rights & ~getAccessRights(cap);
+    const uint32_t bad_level = ~(mask.levels >> getCacheLevel(cap)) & 1;
+    return (missing != 0) | bad_level;
+}
+
+} // namespace workflow
+
+#endif // __CAPABILITY_HH__
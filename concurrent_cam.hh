@@ -0,0 +1,140 @@
+#ifndef __CONCURRENT_CAM_HH__
+#define __CONCURRENT_CAM_HH__
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "cam.hh"
+#include "intmath.hh"
+
+namespace workflow
+{
+
+/**
+ * CAM variant for many concurrent readers and occasional writers.
+ *
+ * find() is wait-free: it takes no lock, never retries, and inspects at
+ * most MaxProbe slots. Writers serialize among themselves on a mutex but
+ * never block readers.
+ *
+ * The table is open addressed with bounded linear probing. A slot is
+ * published by storing its key and then releasing its value; a reader
+ * acquiring a non-null value therefore sees the matching key. Keys are
+ * never removed and a slot never changes key once published, so readers
+ * need neither a sequence counter nor deferred reclamation: re-adding a
+ * present key swaps the value pointer atomically, and a racing reader
+ * returns either the old or the new value.
+ */
+class ConcurrentCAM
+{
+  public:
+    /** Longest probe sequence of any lookup or insertion. */
+    static constexpr unsigned MaxProbe = 32;
+
+  private:
+    struct Slot
+    {
+        std::atomic<Addr> key{0};
+        /** nullptr marks an empty slot. */
+        std::atomic<RegIdPtr> value{nullptr};
+    };
+
+    const size_t _maxSize;
+    const size_t slotMask;
+    std::unique_ptr<Slot[]> slots;
+    std::atomic<size_t> numEntries{0};
+
+    /** Serializes writers only. */
+    std::mutex writeLock;
+
+    size_t home(Addr key) const { return hashAddr(key) & slotMask; }
+
+  public:
+    explicit ConcurrentCAM(size_t max_size = 512)
+        : _maxSize(max_size),
+          // Quarter-full at capacity keeps probe runs far below MaxProbe.
+          slotMask(nextPow2(std::max<size_t>(MaxProbe, 4 * max_size)) - 1),
+          slots(new Slot[slotMask + 1])
+    {
+        assert(max_size > 0);
+    }
+
+    size_t getMaxSize() const { return _maxSize; }
+    size_t size() const { return numEntries.load(std::memory_order_relaxed); }
+
+    /**
+     * Map key to value (which must not be nullptr). Safe to call
+     * concurrently with find() and with other writers. Status Full is also
+     * returned when no free slot lies within MaxProbe of the key's home.
+     */
+    CAMInsertResult
+    add(Addr key, RegIdPtr value)
+    {
+        assert(value != nullptr);
+        std::lock_guard<std::mutex> guard(writeLock);
+
+        const size_t h = home(key);
+        for (unsigned i = 0; i < MaxProbe; i++) {
+            Slot &slot = slots[(h + i) & slotMask];
+            if (slot.value.load(std::memory_order_relaxed) == nullptr) {
+                if (numEntries.load(std::memory_order_relaxed) == _maxSize)
+                    break;
+                slot.key.store(key, std::memory_order_relaxed);
+                slot.value.store(value, std::memory_order_release);
+                numEntries.fetch_add(1, std::memory_order_relaxed);
+                return { CAMInsertResult::Inserted };
+            }
+            if (slot.key.load(std::memory_order_relaxed) == key) {
+                slot.value.store(value, std::memory_order_release);
+                return { CAMInsertResult::Updated };
+            }
+        }
+        return { CAMInsertResult::Full };
+    }
+
+    /** Given the key, find value; nullptr if the key is not present. */
+    RegIdPtr
+    find(Addr key) const
+    {
+        const size_t h = home(key);
+        for (unsigned i = 0; i < MaxProbe; i++) {
+            const Slot &slot = slots[(h + i) & slotMask];
+            RegIdPtr value = slot.value.load(std::memory_order_acquire);
+            // Slots are filled in probe order and never vacated, so the
+            // first empty slot ends the search.
+            if (value == nullptr)
+                return nullptr;
+            if (slot.key.load(std::memory_order_relaxed) == key)
+                return value;
+        }
+        return nullptr;
+    }
+
+    void
+    loop() const
+    {
+        std::vector<std::pair<Addr, RegIdPtr>> contents;
+        for (size_t i = 0; i <= slotMask; i++) {
+            RegIdPtr value = slots[i].value.load(std::memory_order_acquire);
+            if (value != nullptr)
+                contents.emplace_back(
+                        slots[i].key.load(std::memory_order_relaxed), value);
+        }
+        std::sort(contents.begin(), contents.end());
+
+        std::cout << "Displaying CAM contents now (KEY: VALUE)..."
+                  << std::endl;
+        for (const auto &kv : contents)
+            std::cout << kv.first << ": " << *kv.second << std::endl;
+    }
+};
+
+} // namespace workflow
+
+#endif // __CONCURRENT_CAM_HH__
@@ -3,17 +3,53 @@
 namespace debug
 {
 
+FlagsMap &
+allFlags()
+{
+    static FlagsMap flags;
+    return flags;
+}
+
+Flag *
+findFlag(const std::string &name)
+{
+    FlagsMap::iterator i = allFlags().find(name);
+    if (i == allFlags().end())
+        return nullptr;
+    return i->second;
+}
+
 Flag::Flag(const char *name, const char *desc)
     : _name(name), _desc(desc)
-{}
+{
+    allFlags().emplace(_name, this);
+}
 
 bool Flag::_globalEnable = false;
 
+void
+Flag::globalEnable()
+{
+    _globalEnable = true;
+    for (auto &i : allFlags())
+        i.second->sync();
+}
+
+void
+Flag::globalDisable()
+{
+    _globalEnable = false;
+    for (auto &i : allFlags())
+        i.second->sync();
+}
+
 SimpleFlag::SimpleFlag(const char *name, const char *desc, bool is_format)
   : Flag(name, desc), _isFormat(is_format)
 {}
 
 Flag::~Flag()
-{}
+{
+    allFlags().erase(_name);
+}
 
 }
@@ -1,12 +1,17 @@
 #ifndef __BASE_DEBUG_HH__
 #define __BASE_DEBUG_HH__
 
+#include <cstdio>
+#include <cstdlib>
 #include <initializer_list>
 #include <iostream>
 #include <map>
 #include <string>
 #include <vector>
 
+#define panic(arg...) \
+  do { printf("Panic: " arg); exit(1); } while (0)
+
 namespace debug
 {
 
@@ -42,6 +47,12 @@ class Flag
     static void globalDisable();
 };
 
+typedef std::map<std::string, Flag *> FlagsMap;
+FlagsMap &allFlags();
+
+/** Find a flag by name, or return nullptr. */
+Flag *findFlag(const std::string &name);
+
 class SimpleFlag : public Flag
 {
   protected:
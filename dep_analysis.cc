@@ -0,0 +1,39 @@
+#include "dep_analysis.hh"
+
+#include "debug.hh"
+
+namespace workflow
+{
+
+void
+DepAnalysisStats::print(std::ostream &os) const
+{
+    os << "insts " << insts << '\n'
+       << "criticalPath " << criticalPath << '\n'
+       << "ilp " << ilp() << '\n'
+       << "criticalPathNoRename " << criticalPathNoRename << '\n'
+       << "ilpNoRename " << ilpNoRename() << '\n'
+       << "avgLifetime " << avgLifetime() << '\n'
+       << "maxLifetime " << maxLifetime << '\n';
+    unsigned last = NumLifetimeBuckets;
+    while (last > 0 && lifetimes[last - 1] == 0)
+        last--;
+    for (unsigned b = 0; b < last; b++) {
+        os << "lifetime[" << (uint64_t(1) << b) - 1 << '-'
+           << (uint64_t(1) << (b + 1)) - 2 << "] " << lifetimes[b]
+           << '\n';
+    }
+}
+
+DependencyAnalyzer::DependencyAnalyzer(unsigned num_arch_regs,
+                                       unsigned num_phys_regs,
+                                       unsigned _latency)
+    : latency(_latency),
+      physReady(num_phys_regs, 0), allocatedAt(num_phys_regs, 0),
+      archReady(num_arch_regs, 0), archLastRead(num_arch_regs, 0)
+{
+    if (latency == 0)
+        panic("Dependency analysis needs a latency of at least 1\n");
+}
+
+} // namespace workflow
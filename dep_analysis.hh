@@ -0,0 +1,158 @@
+#ifndef __DEP_ANALYSIS_HH__
+#define __DEP_ANALYSIS_HH__
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "regfile.hh"
+#include "rename_map.hh"
+#include "trace.hh"
+
+namespace workflow
+{
+
+struct DepAnalysisStats
+{
+    /** Power-of-two buckets of the lifetime histogram. */
+    static constexpr unsigned NumLifetimeBuckets = 32;
+
+    uint64_t insts = 0;
+    /** Cycles to run every instruction on unlimited hardware. */
+    uint64_t criticalPath = 0;
+    /** The same, with false (WAR, WAW) dependencies kept. */
+    uint64_t criticalPathNoRename = 0;
+
+    /**
+     * Mappings by lifetime: the number of instructions renamed from the
+     * one that allocates a physical register to the one that replaces
+     * it. Bucket b counts lifetimes in [2^b - 1, 2^(b+1) - 1).
+     */
+    uint64_t lifetimes[NumLifetimeBuckets] = {};
+    uint64_t numLifetimes = 0;
+    uint64_t lifetimeSum = 0;
+    uint64_t maxLifetime = 0;
+
+    double
+    ilp() const
+    {
+        return criticalPath ? double(insts) / criticalPath : 0.0;
+    }
+
+    double
+    ilpNoRename() const
+    {
+        return criticalPathNoRename ?
+            double(insts) / criticalPathNoRename : 0.0;
+    }
+
+    double
+    avgLifetime() const
+    {
+        return numLifetimes ? double(lifetimeSum) / numLifetimes : 0.0;
+    }
+
+    void print(std::ostream &os) const;
+};
+
+/**
+ * One-pass dataflow analysis of a renamed instruction stream.
+ *
+ * Each instruction issues once its sources are ready and its result is
+ * ready latency cycles later; the time its last result is ready is the
+ * critical path, and instructions over critical path the ILP renaming
+ * exposes. The same is tracked over architectural registers, where a
+ * write also waits for earlier reads and writes of its destination, to
+ * show what renaming buys. A mapping lives from its rename to the rename
+ * of the next write to the same architectural register.
+ *
+ * State is a few words per physical and architectural register, so the
+ * memory used does not depend on trace length; feed it from a
+ * TraceReader to analyze traces larger than memory. Moves must not be
+ * eliminated, as lifetimes assume every rename allocates.
+ */
+class DependencyAnalyzer
+{
+  private:
+    const uint64_t latency;
+
+    /** By physical register flat index. */
+    /** @{ */
+    std::vector<uint64_t> physReady;
+    std::vector<uint64_t> allocatedAt;
+    /** @} */
+
+    /** By architectural register index. */
+    /** @{ */
+    std::vector<uint64_t> archReady;
+    std::vector<uint64_t> archLastRead;
+    /** @} */
+
+    DepAnalysisStats _stats;
+
+    void
+    addLifetime(uint64_t lifetime)
+    {
+        const unsigned bucket = std::min<unsigned>(
+                63 - __builtin_clzll(lifetime + 1),
+                DepAnalysisStats::NumLifetimeBuckets - 1);
+        _stats.lifetimes[bucket]++;
+        _stats.numLifetimes++;
+        _stats.lifetimeSum += lifetime;
+        _stats.maxLifetime = std::max(_stats.maxLifetime, lifetime);
+    }
+
+  public:
+    DependencyAnalyzer(unsigned num_arch_regs, unsigned num_phys_regs,
+                       unsigned latency = 1);
+
+    /**
+     * Account for rec, whose sources were renamed to srcs and whose
+     * destination rename returned info.
+     */
+    void
+    record(const TraceRecord &rec, const PhysRegIdPtr *srcs,
+           const RenameMap::RenameInfo &info)
+    {
+        const uint64_t inst = _stats.insts++;
+
+        uint64_t issue = 0;
+        uint64_t issue_no_rename = 0;
+        for (unsigned s = 0; s < rec.numSrcs; s++) {
+            issue = std::max(issue, physReady[srcs[s]->flatIndex()]);
+            issue_no_rename =
+                std::max(issue_no_rename, archReady[rec.srcs[s]]);
+        }
+        // Without renaming the write, at issue + latency, must come after
+        // the last read of its destination and the previous write.
+        const uint64_t after =
+            std::max(archLastRead[rec.dest], archReady[rec.dest]) + 1;
+        if (after > latency)
+            issue_no_rename = std::max(issue_no_rename, after - latency);
+        for (unsigned s = 0; s < rec.numSrcs; s++) {
+            uint64_t &last_read = archLastRead[rec.srcs[s]];
+            last_read = std::max(last_read, issue_no_rename);
+        }
+
+        const uint64_t ready = issue + latency;
+        const uint64_t ready_no_rename = issue_no_rename + latency;
+        physReady[info.first->flatIndex()] = ready;
+        archReady[rec.dest] = ready_no_rename;
+        _stats.criticalPath = std::max(_stats.criticalPath, ready);
+        _stats.criticalPathNoRename =
+            std::max(_stats.criticalPathNoRename, ready_no_rename);
+
+        // A reused register lives on.
+        if (info.first != info.second) {
+            addLifetime(inst - allocatedAt[info.second->flatIndex()]);
+            allocatedAt[info.first->flatIndex()] = inst;
+        }
+    }
+
+    const DepAnalysisStats &stats() const { return _stats; }
+};
+
+} // namespace workflow
+
+#endif // __DEP_ANALYSIS_HH__
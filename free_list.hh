@@ -1,8 +1,11 @@
 #ifndef __CPU_O3_FREE_LIST_HH__
 #define __CPU_O3_FREE_LIST_HH__
 
-#include <queue>
+#include <algorithm>
+#include <deque>
+#include <iterator>
 
+#include "probe.hh"
 #include "regfile.hh"
 
 
@@ -19,31 +22,66 @@ class SimpleFreeList
 {
   private:
 
-    /** The actual free list */
-    std::queue<PhysRegIdPtr> freeRegs;
+    /** The actual free list, allocated from the front */
+    std::deque<PhysRegIdPtr> freeRegs;
+
+    /**
+     * Append op(*it) for every it in [first, last), growing the list
+     * once rather than per register.
+     */
+    template<class ForwardIt, class UnaryOp>
+    void
+    append(ForwardIt first, ForwardIt last, UnaryOp op)
+    {
+        const size_t old_size = freeRegs.size();
+        freeRegs.resize(old_size + std::distance(first, last));
+        std::transform(first, last, freeRegs.begin() + old_size, op);
+    }
+
+    static PhysRegIdPtr addressOf(PhysRegId &reg) { return &reg; }
 
   public:
 
     SimpleFreeList() {};
 
+    /** A free list of the registers in [first, last), in order. */
+    template<class ForwardIt>
+    SimpleFreeList(ForwardIt first, ForwardIt last)
+        : freeRegs(std::distance(first, last))
+    {
+        std::transform(first, last, freeRegs.begin(), addressOf);
+    }
+
     /** Add a physical register to the free list */
-    void addReg(PhysRegIdPtr reg) { freeRegs.push(reg); }
+    void addReg(PhysRegIdPtr reg) { freeRegs.push_back(reg); }
+
+    /** Add the physical registers in [first, last) to the free list */
+    template<class ForwardIt>
+    void
+    addRegs(ForwardIt first, ForwardIt last)
+    {
+        append(first, last, addressOf);
+    }
 
-    /** Add physical registers to the free list */
-    template<class InputIt>
+    /**
+     * Replace the free list with op(*it) for every it in [first, last),
+     * e.g. registers looked up by flat index.
+     */
+    template<class ForwardIt, class UnaryOp>
     void
-    addRegs(InputIt first, InputIt last) {
-        std::for_each(first, last, [this](typename InputIt::value_type& reg) {
-            freeRegs.push(&reg);
-        });
+    assign(ForwardIt first, ForwardIt last, UnaryOp op)
+    {
+        freeRegs.clear();
+        append(first, last, op);
     }
 
     /** Get the next available register from the free list */
     PhysRegIdPtr getReg()
     {
+        PROBE_SCOPE(FreeListGetReg);
         assert(!freeRegs.empty());
         PhysRegIdPtr free_reg = freeRegs.front();
-        freeRegs.pop();
+        freeRegs.pop_front();
         return free_reg;
     }
 
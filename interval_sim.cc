@@ -0,0 +1,72 @@
+#include "interval_sim.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace workflow
+{
+
+SimStats
+runIntervals(const RegClass &reg_class, unsigned num_phys_regs,
+             const std::vector<TraceRecord> &trace,
+             const IntervalConfig &config)
+{
+    const size_t length = std::max<size_t>(1, config.intervalLength);
+    const size_t num_intervals = (trace.size() + length - 1) / length;
+    const TraceRecord *records = trace.data();
+
+    // Functional pass: the state at each interval's warmup start.
+    std::vector<RenameState> snapshots(num_intervals);
+    RenameState state = RenameState::initial(reg_class.numRegs(),
+                                             num_phys_regs);
+    size_t pos = 0;
+    for (size_t i = 0; i < num_intervals; i++) {
+        const size_t start = i * length;
+        const size_t warm_start = start - std::min(start, config.warmup);
+        fastForward(state, records + pos, records + warm_start);
+        pos = warm_start;
+        snapshots[i] = state;
+    }
+
+    unsigned num_threads = config.numThreads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min<size_t>(num_threads,
+                                   std::max<size_t>(1, num_intervals));
+
+    std::atomic<size_t> next_interval{0};
+    std::vector<SimStats> worker_stats(num_threads);
+    auto worker = [&](unsigned id) {
+        // One simulator per worker, reloaded for every interval.
+        RenameSim sim(reg_class, num_phys_regs);
+        size_t i;
+        while ((i = next_interval.fetch_add(1)) < num_intervals) {
+            const size_t start = i * length;
+            const size_t warm_start =
+                start - std::min(start, config.warmup);
+            const size_t end = std::min(start + length, trace.size());
+
+            sim.loadState(snapshots[i]);
+            snapshots[i] = RenameState();
+            sim.execute(records + warm_start, records + start);
+            sim.resetStats();
+            sim.execute(records + start, records + end);
+            worker_stats[id].merge(sim.stats());
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned id = 1; id < num_threads; id++)
+        threads.emplace_back(worker, id);
+    worker(0);
+    for (std::thread &t : threads)
+        t.join();
+
+    SimStats total;
+    for (const SimStats &s : worker_stats)
+        total.merge(s);
+    return total;
+}
+
+} // namespace workflow
@@ -0,0 +1,38 @@
+#ifndef __INTERVAL_SIM_HH__
+#define __INTERVAL_SIM_HH__
+
+#include <vector>
+
+#include "rename_sim.hh"
+
+namespace workflow
+{
+
+struct IntervalConfig
+{
+    /** Records per interval. */
+    size_t intervalLength = 100000;
+    /**
+     * Records replayed in detail ahead of each interval with statistics
+     * discarded, to warm up state the snapshots do not carry.
+     */
+    size_t warmup = 0;
+    /** Worker threads; 0 uses every hardware thread. */
+    unsigned numThreads = 0;
+};
+
+/**
+ * Replay trace split into intervals simulated in parallel.
+ *
+ * A serial fastForward() pass produces the RenameState at the start of
+ * every interval (less its warmup). Workers then claim intervals, each
+ * loading the snapshot into its own RenameSim, and the per-interval
+ * statistics are merged. The result matches a serial RenameSim replay.
+ */
+SimStats runIntervals(const RegClass &reg_class, unsigned num_phys_regs,
+                      const std::vector<TraceRecord> &trace,
+                      const IntervalConfig &config);
+
+} // namespace workflow
+
+#endif // __INTERVAL_SIM_HH__
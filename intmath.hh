@@ -0,0 +1,35 @@
+#ifndef __INTMATH_HH__
+#define __INTMATH_HH__
+
+#include <cstddef>
+#include <cstdint>
+
+namespace workflow
+{
+
+/** Round up to the next power of two (n > 0). */
+inline size_t
+nextPow2(size_t n)
+{
+    size_t p = 1;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+/**
+ * Advance a xorshift64 generator and return its new state. The state
+ * must start nonzero; it then never becomes zero.
+ */
+inline uint64_t
+xorshift64(uint64_t &state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+} // namespace workflow
+
+#endif // __INTMATH_HH__
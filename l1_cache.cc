@@ -0,0 +1,127 @@
+#include "l1_cache.hh"
+
+#include <algorithm>
+#include <cassert>
+
+#include "debug.hh"
+
+namespace workflow
+{
+
+void
+L1CacheStats::print(std::ostream &os) const
+{
+    os << "l1.reads " << reads << '\n'
+       << "l1.writes " << writes << '\n'
+       << "l1.hits " << hits << '\n'
+       << "l1.compulsoryMisses " << compulsoryMisses << '\n'
+       << "l1.capacityMisses " << capacityMisses << '\n'
+       << "l1.conflictMisses " << conflictMisses << '\n'
+       << "l1.writebacks " << writebacks << '\n'
+       << "l1.hitRate " << hitRate() << '\n';
+}
+
+L1Cache::L1Cache(const L1CacheConfig &config)
+    : numSets(config.sets), assoc(config.assoc),
+      tags(size_t(config.sets) * config.assoc, InvalidTag),
+      states(size_t(config.sets) * config.assoc, Invalid),
+      replPolicy(makeReplacementPolicy(config.policy, numSets, assoc)),
+      seen(NumLines, 0), inShadow(NumLines, 0),
+      shadowPrev(NumLines, Nil), shadowNext(NumLines, Nil)
+{
+    if (numSets == 0 || assoc == 0)
+        panic("L1 cache needs at least one set and one way\n");
+}
+
+unsigned
+L1Cache::miss(unsigned set, uint32_t line)
+{
+    if (!seen[line]) {
+        _stats.compulsoryMisses++;
+        seen[line] = 1;
+    } else if (inShadow[line]) {
+        _stats.conflictMisses++;
+    } else {
+        _stats.capacityMisses++;
+    }
+
+    const size_t base = size_t(set) * assoc;
+    unsigned way = assoc;
+    for (unsigned w = 0; w < assoc; w++) {
+        if (states[base + w] == Invalid) {
+            way = w;
+            break;
+        }
+    }
+    if (way == assoc) {
+        way = replPolicy->getVictim(set);
+        _stats.writebacks += states[base + way] == Dirty;
+    }
+    tags[base + way] = line / numSets;
+    states[base + way] = Clean;
+    replPolicy->reset(set, way);
+    return way;
+}
+
+void
+L1Cache::touchShadow(uint32_t line)
+{
+    if (shadowHead == line)
+        return;
+    if (inShadow[line]) {
+        // Unlink; line is not the head, so it has a predecessor.
+        shadowNext[shadowPrev[line]] = shadowNext[line];
+        if (shadowNext[line] != Nil)
+            shadowPrev[shadowNext[line]] = shadowPrev[line];
+        else
+            shadowTail = shadowPrev[line];
+    } else if (shadowSize == size_t(numSets) * assoc) {
+        const uint16_t victim = shadowTail;
+        shadowTail = shadowPrev[victim];
+        if (shadowTail != Nil)
+            shadowNext[shadowTail] = Nil;
+        else
+            shadowHead = Nil;
+        inShadow[victim] = 0;
+    } else {
+        shadowSize++;
+    }
+    inShadow[line] = 1;
+    shadowPrev[line] = Nil;
+    shadowNext[line] = shadowHead;
+    if (shadowHead != Nil)
+        shadowPrev[shadowHead] = line;
+    else
+        shadowTail = line;
+    shadowHead = line;
+}
+
+uint64_t
+L1Cache::accessCaps(const RegVal *caps, unsigned n, bool write)
+{
+    assert(n <= 64);
+    uint32_t lines[64];
+    for (unsigned i = 0; i < n; i++)
+        lines[i] = getCacheLineNumber(caps[i]);
+    uint64_t hits = 0;
+    for (unsigned i = 0; i < n; i++)
+        hits |= uint64_t(access(lines[i], write)) << i;
+    return hits;
+}
+
+void
+L1Cache::invalidate()
+{
+    for (size_t i = 0; i < tags.size(); i++) {
+        if (states[i] != Invalid)
+            replPolicy->invalidate(i / assoc, i % assoc);
+        tags[i] = InvalidTag;
+        states[i] = Invalid;
+    }
+    std::fill(seen.begin(), seen.end(), 0);
+    std::fill(inShadow.begin(), inShadow.end(), 0);
+    shadowHead = shadowTail = Nil;
+    shadowSize = 0;
+}
+
+} // namespace workflow
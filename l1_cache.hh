@@ -0,0 +1,161 @@
+#ifndef __L1_CACHE_HH__
+#define __L1_CACHE_HH__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "capability.hh"
+#include "regfile.hh"
+#include "replacement_policies.hh"
+
+namespace workflow
+{
+
+struct L1CacheConfig
+{
+    /** Number of sets; 0 disables the model. */
+    unsigned sets = 0;
+    unsigned assoc = 8;
+    ReplacementPolicyType policy = ReplacementPolicyType::LRU;
+
+    bool enabled() const { return sets != 0; }
+};
+
+struct L1CacheStats
+{
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t hits = 0;
+    /** Misses by cause: first reference to the line, ... */
+    uint64_t compulsoryMisses = 0;
+    /** ... one a fully associative LRU cache as large would also miss, */
+    uint64_t capacityMisses = 0;
+    /** ... and the rest, due to the set mapping. */
+    uint64_t conflictMisses = 0;
+    /** Dirty lines evicted. */
+    uint64_t writebacks = 0;
+
+    uint64_t accesses() const { return reads + writes; }
+
+    uint64_t
+    misses() const
+    {
+        return compulsoryMisses + capacityMisses + conflictMisses;
+    }
+
+    double
+    hitRate() const
+    {
+        return accesses() ? double(hits) / accesses() : 0.0;
+    }
+
+    void print(std::ostream &os) const;
+};
+
+/**
+ * Tag and state model of a set-associative L1 data cache over the line
+ * numbers carried by capabilities (getCacheLineNumber()). Line l maps to
+ * set l % sets with tag l / sets. No data is kept.
+ *
+ * Tags and line states are parallel arrays indexed by set * assoc + way,
+ * so a lookup scans one short contiguous run of 16-bit tags. To split
+ * misses by cause the model also runs a fully associative LRU cache of
+ * the same size alongside, as a recency list linked through arrays
+ * indexed by line number, so classifying a miss is O(1).
+ */
+class L1Cache
+{
+  public:
+    static constexpr unsigned NumLines = 1u << CapLineBits;
+
+  private:
+    enum LineState : uint8_t { Invalid, Clean, Dirty };
+
+    static constexpr uint16_t InvalidTag = UINT16_MAX;
+    static constexpr uint16_t Nil = UINT16_MAX;
+
+    const unsigned numSets;
+    const unsigned assoc;
+
+    std::vector<uint16_t> tags;
+    std::vector<uint8_t> states;
+    std::unique_ptr<ReplacementPolicy> replPolicy;
+
+    /** Fully associative shadow cache, by line number. */
+    /** @{ */
+    std::vector<uint8_t> seen;
+    std::vector<uint8_t> inShadow;
+    std::vector<uint16_t> shadowPrev;
+    std::vector<uint16_t> shadowNext;
+    uint16_t shadowHead = Nil;
+    uint16_t shadowTail = Nil;
+    unsigned shadowSize = 0;
+    /** @} */
+
+    L1CacheStats _stats;
+
+    /** Way holding tag in set, or assoc if absent. */
+    unsigned
+    findWay(unsigned set, uint16_t tag) const
+    {
+        const uint16_t *set_tags = &tags[size_t(set) * assoc];
+        for (unsigned way = 0; way < assoc; way++) {
+            if (set_tags[way] == tag)
+                return way;
+        }
+        return assoc;
+    }
+
+    /** Classify and fill a miss on line; return the way filled. */
+    unsigned miss(unsigned set, uint32_t line);
+
+    /** Make line the most recent in the shadow cache. */
+    void touchShadow(uint32_t line);
+
+  public:
+    explicit L1Cache(const L1CacheConfig &config);
+
+    /**
+     * Look up line, filling it on a miss; a write leaves it dirty.
+     * @return Whether the access hit.
+     */
+    bool
+    access(uint32_t line, bool write)
+    {
+        const unsigned set = line % numSets;
+        const uint16_t tag = line / numSets;
+        unsigned way = findWay(set, tag);
+        const bool hit = way != assoc;
+        if (hit) {
+            _stats.hits++;
+            replPolicy->touch(set, way);
+        } else {
+            way = miss(set, line);
+        }
+        uint8_t &state = states[size_t(set) * assoc + way];
+        state = write ? uint8_t(Dirty) : state;
+        _stats.reads += !write;
+        _stats.writes += write;
+        touchShadow(line);
+        return hit;
+    }
+
+    /**
+     * Access the lines named by a group of n <= 64 capabilities, in
+     * order. Line numbers are extracted in one pass first.
+     * @return A mask with bit i set if access i hit.
+     */
+    uint64_t accessCaps(const RegVal *caps, unsigned n, bool write);
+
+    /** Drop every line without counting writebacks. */
+    void invalidate();
+
+    const L1CacheStats &stats() const { return _stats; }
+    void resetStats() { _stats = L1CacheStats(); }
+};
+
+} // namespace workflow
+
+#endif // __L1_CACHE_HH__
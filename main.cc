@@ -1,88 +1,881 @@
+#include <algorithm>
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include <unistd.h>
+
+#include "cam.hh"
+#include "capability.hh"
+#include "concurrent_cam.hh"
+#include "dep_analysis.hh"
+#include "interval_sim.hh"
+#include "pipeline.hh"
+#include "probe.hh"
 #include "reg_class.hh"
 #include "rename_map.hh"
+#include "rename_sim.hh"
 #include "regfile_o3.hh"
+#include "static_rename_map.hh"
+#include "sweep.hh"
+#include "threaded_pipeline.hh"
+#include "trace.hh"
 
 using namespace std;
 
 using namespace workflow;
 
-class CAM
-{
-  private:
-    const uint16_t _max_size = 512;
-
-  public:
-    uint16_t getMaxSize() {
-      return _max_size;
-    }
-    // we change this to Addr and register number, 
-    // whatever their formats are
-    // keeping them to <int, RegIdPtr> now
-    typedef std::map<int, RegIdPtr> cam_map_t;
-    void add( int key, RegIdPtr value ) {
-        cam_map_t::const_iterator it = m_table.find( key );
-        if ( m_table.size() == _max_size ) { 
-            // handle error, throw exception...
-            cout << "CAM is full. Cannot add!" << endl;
-        } else {
-            m_table.insert( it, std::make_pair(key, value) );
+static const char *progName = "cap-reg-rename";
+
+static void
+usage()
+{
+    cout << "usage: " << progName << " [mode [options]]\n"
+         << "modes:\n"
+         << "  demo       rename walkthrough (default)\n"
+         << "  interval   replay a trace in parallel intervals\n"
+         << "  pipeline   cycle-driven decode/rename/dispatch model\n"
+         << "  threaded   decode, rename and update on separate threads\n"
+         << "  sweep      run the pipeline over a grid of configurations\n"
+         << "  analyze    dependency, ILP and register lifetime analysis\n"
+         << "  startup    time to the first rename of the demo setup\n"
+         << "  cam        concurrent CAM lookups racing a writer, checked\n"
+         << "             against CAM\n"
+         << "trace options:\n"
+         << "  -t FILE    read the trace from FILE\n"
+         << "  -n N       generate N instructions (default 1000000)\n"
+         << "  -s SEED    generator seed (default 1)\n"
+         << "  -v PCT     percentage of generated records that are moves\n"
+         << "  -u PCT     percentage of generated writes that pin their\n"
+         << "             register for 1 to 3 further writes\n"
+         << "  -a N       architectural registers (default 32)\n"
+         << "  -p N       physical registers (default 128)\n"
+         << "  -H         transparent huge pages for large tables\n"
+         << "  -T CLOCK   clock of the timing probes: tsc|perf (builds\n"
+         << "             with -DPROBES=1 only; default tsc)\n"
+         << "interval options:\n"
+         << "  -i N       records per interval (default 100000)\n"
+         << "  -w N       warmup records per interval (default 0)\n"
+         << "  -j N       worker threads (default: all)\n"
+         << "  -c         also replay serially and compare\n"
+         << "pipeline options:\n"
+         << "  -W N       width of every stage (default 4)\n"
+         << "  -Q N       capacity of every stage queue (default 16)\n"
+         << "  -b N       register file banks (default 1, unbanked)\n"
+         << "  -m MAP     bank mapping: interleaved|partitioned\n"
+         << "  -A POLICY  bank allocation: rr|least\n"
+         << "  -P R,W     read and write ports per bank (default 2,1)\n"
+         << "  -L W[,F]   register write latency and further cycles until\n"
+         << "             the previous mapping is freed (default 0,0)\n"
+         << "  -E         eliminate moves by sharing physical registers\n"
+         << "  -K         check read and written capabilities for read or\n"
+         << "             write rights and an L1 cache level\n"
+         << "  -C N[,W[,POLICY]]\n"
+         << "             register cache of N entries, W ways (default 4),\n"
+         << "             POLICY lru|tree-plru|random|fifo (default lru)\n"
+         << "  -D S[,W[,POLICY]]\n"
+         << "             L1 model of S sets and W ways (default 8) fed the\n"
+         << "             lines of the capabilities read, POLICY as for -C\n"
+         << "  -c         also replay functionally and compare\n"
+         << "threaded options:\n"
+         << "  -B N       batches per stage queue (default 64)\n"
+         << "  -b/-m/-A   register file banking, as for pipeline\n"
+         << "  -C ...     register cache, as for pipeline\n"
+         << "  -E         move elimination, as for pipeline\n"
+         << "  -K         capability checks, as for pipeline\n"
+         << "  -c         also replay functionally and compare\n"
+         << "sweep options (pipeline options apply to every point):\n"
+         << "  -p N,...   physical register counts\n"
+         << "  -M N,...   CAM sizes (default 512)\n"
+         << "  -W N,...   rename widths\n"
+         << "  -j N       worker threads (default: all)\n"
+         << "  -K/-D ...  capability checks and L1 model, reported per point\n"
+         << "analyze options:\n"
+         << "  -l N       result latency in cycles (default 1)\n"
+         << "cam options:\n"
+         << "  -M N       CAM size (default 512)\n"
+         << "  -j N       reader threads (default: all but the writer's)\n"
+         << "startup options:\n"
+         << "  -M N,...   CAM, register class and register file sizes\n"
+         << "             (default 64,512,4096,32768)\n";
+}
+
+struct Options
+{
+    std::string traceFile;
+    size_t numInsts = 1000000;
+    uint64_t seed = 1;
+    unsigned movePercent = 0;
+    unsigned pinPercent = 0;
+    unsigned numArchRegs = 32;
+    unsigned numPhysRegs = 128;
+    IntervalConfig interval;
+    PipelineConfig pipeline;
+    ThreadedPipelineConfig threaded;
+    BankConfig banks;
+    RegCacheConfig regCache;
+    SweepConfig sweep;
+    std::vector<size_t> startupSizes = {64, 512, 4096, 32768};
+    unsigned latency = 1;
+    bool eliminateMoves = false;
+    bool checkCaps = false;
+    bool compare = false;
+};
+
+/** What -K checks: the right needed and an L1 cache level. */
+static const CapAccessMask CheckRead = {CapRead, 1 << 1};
+static const CapAccessMask CheckWrite = {CapWrite, 1 << 1};
+
+/** Enable checked access if requested; call after initial state loads. */
+static void
+setCapChecks(const Options &opts, PhysRegFile &reg_file)
+{
+    if (opts.checkCaps)
+        reg_file.setCheckedAccess(CheckRead, CheckWrite);
+}
+
+/**
+ * Print capability check counts if checked access is on, and the read
+ * faults of the registers still mapped, found with checkRegs() and
+ * checked against one getReg() per register. Call once the run is over.
+ */
+static void
+printCapChecks(RenameContext &ctx)
+{
+    PhysRegFile &reg_file = ctx.regFile;
+    if (!reg_file.checkedAccess())
+        return;
+    reg_file.capCheckStats().print(cout);
+
+    reg_file.flushRegCache();
+    std::vector<PhysRegIdPtr> live(ctx.renameMap.begin(),
+                                   ctx.renameMap.end());
+    uint64_t live_faults = 0;
+    for (size_t first = 0; first < live.size(); first += 64) {
+        const unsigned num = std::min<size_t>(64, live.size() - first);
+        const uint64_t faults =
+            reg_file.checkRegs(&live[first], num, CheckRead);
+        for (unsigned i = 0; i < num; i++) {
+            const RegVal val = reg_file.getReg(live[first + i]);
+            if ((faults >> i & 1) != capFault(val, CheckRead))
+                panic("checkRegs() disagrees on register %u\n",
+                      unsigned(live[first + i]->flatIndex()));
+        }
+        live_faults += std::bitset<64>(faults).count();
+    }
+    cout << "capLiveReadFaults " << live_faults << '\n';
+}
+
+/** Parse a comma separated list of numbers. */
+template <class T>
+static void
+parseList(const char *arg, std::vector<T> &values)
+{
+    values.clear();
+    const char *pos = arg;
+    char *end;
+    while (true) {
+        values.push_back(strtoull(pos, &end, 0));
+        if (end == pos)
+            panic("Bad number list %s\n", arg);
+        if (*end != ',')
+            break;
+        pos = end + 1;
+    }
+    if (*end)
+        panic("Bad number list %s\n", arg);
+}
+
+static void
+parseRegCache(const char *arg, RegCacheConfig &config)
+{
+    char policy[32] = "";
+    if (sscanf(arg, "%u,%u,%31s", &config.entries, &config.assoc,
+               policy) < 1)
+        panic("Register cache must be given as N[,W[,POLICY]]\n");
+    if (policy[0] && !parseReplacementPolicy(policy, config.policy))
+        panic("Unknown replacement policy %s\n", policy);
+    if (config.entries &&
+        (config.assoc == 0 || config.entries % config.assoc != 0))
+        panic("Register cache entries must be a multiple of its ways\n");
+}
+
+static void
+parseL1Cache(const char *arg, L1CacheConfig &config)
+{
+    char policy[32] = "";
+    if (sscanf(arg, "%u,%u,%31s", &config.sets, &config.assoc,
+               policy) < 1)
+        panic("L1 cache must be given as S[,W[,POLICY]]\n");
+    if (policy[0] && !parseReplacementPolicy(policy, config.policy))
+        panic("Unknown replacement policy %s\n", policy);
+    if (config.sets && config.assoc == 0)
+        panic("L1 cache needs at least one way\n");
+}
+
+static void
+parseProbeClock(const char *arg)
+{
+    if (!PROBES)
+        panic("Timing probes are compiled out; build with -DPROBES=1\n");
+    const std::string name = arg;
+    if (name == "tsc") {
+        setProbeClock(ProbeClock::TSC);
+    } else if (name == "perf") {
+        if (!setProbeClock(ProbeClock::PerfTaskClock))
+            cerr << "perf_event_open unavailable, using tsc" << endl;
+    } else {
+        panic("Unknown probe clock %s\n", arg);
+    }
+}
+
+static void
+parseOptions(int argc, char **argv, Options &opts)
+{
+    static const char *optString =
+        "t:n:s:v:u:a:p:i:w:j:W:Q:B:b:m:A:P:C:D:M:L:l:T:EHKch";
+    int c;
+    while ((c = getopt(argc, argv, optString)) != -1) {
+        switch (c) {
+          case 't': opts.traceFile = optarg; break;
+          case 'n': opts.numInsts = strtoull(optarg, nullptr, 0); break;
+          case 's': opts.seed = strtoull(optarg, nullptr, 0); break;
+          case 'v': opts.movePercent = strtoul(optarg, nullptr, 0); break;
+          case 'u': opts.pinPercent = strtoul(optarg, nullptr, 0); break;
+          case 'a': opts.numArchRegs = strtoul(optarg, nullptr, 0); break;
+          case 'p':
+            parseList(optarg, opts.sweep.physRegs);
+            opts.numPhysRegs = opts.sweep.physRegs.front();
+            break;
+          case 'i':
+            opts.interval.intervalLength = strtoull(optarg, nullptr, 0);
+            break;
+          case 'w':
+            opts.interval.warmup = strtoull(optarg, nullptr, 0);
+            break;
+          case 'j':
+            opts.interval.numThreads = opts.sweep.numThreads =
+                strtoul(optarg, nullptr, 0);
+            break;
+          case 'W':
+            parseList(optarg, opts.sweep.renameWidths);
+            // A sweep varies rename alone; the other stages keep up.
+            opts.pipeline.renameWidth = opts.sweep.renameWidths.front();
+            opts.pipeline.decodeWidth = opts.pipeline.dispatchWidth =
+                *std::max_element(opts.sweep.renameWidths.begin(),
+                                  opts.sweep.renameWidths.end());
+            break;
+          case 'Q':
+            opts.pipeline.decodeQueueSize = opts.pipeline.renameQueueSize =
+                strtoull(optarg, nullptr, 0);
+            break;
+          case 'B':
+            opts.threaded.queueBatches = strtoull(optarg, nullptr, 0);
+            break;
+          case 'b': opts.banks.numBanks = strtoul(optarg, nullptr, 0); break;
+          case 'm':
+            if (!parseBankMapping(optarg, opts.banks.mapping))
+                panic("Unknown bank mapping %s\n", optarg);
+            break;
+          case 'A':
+            if (!parseBankAllocPolicy(optarg, opts.banks.alloc))
+                panic("Unknown bank allocation policy %s\n", optarg);
+            break;
+          case 'P':
+            if (sscanf(optarg, "%u,%u", &opts.banks.readPorts,
+                       &opts.banks.writePorts) != 2)
+                panic("Ports must be given as R,W\n");
+            break;
+          case 'C': parseRegCache(optarg, opts.regCache); break;
+          case 'D': parseL1Cache(optarg, opts.pipeline.l1); break;
+          case 'L':
+            if (sscanf(optarg, "%u,%u", &opts.pipeline.writeLatency,
+                       &opts.pipeline.freeLatency) < 1)
+                panic("Latencies must be given as W[,F]\n");
+            break;
+          case 'l': opts.latency = strtoul(optarg, nullptr, 0); break;
+          case 'M':
+            parseList(optarg, opts.sweep.camSizes);
+            opts.startupSizes = opts.sweep.camSizes;
+            break;
+          case 'E': opts.eliminateMoves = true; break;
+          case 'H': pageAllocOptions().hugePages = true; break;
+          case 'T': parseProbeClock(optarg); break;
+          case 'K': opts.checkCaps = true; break;
+          case 'c': opts.compare = true; break;
+          default:
+            usage();
+            exit(c == 'h' ? 0 : 1);
+        }
+    }
+    for (unsigned phys : opts.sweep.physRegs) {
+        if (opts.numArchRegs == 0 || opts.numArchRegs >= phys)
+            panic("Need 0 < architectural registers < physical "
+                  "registers\n");
+        if (phys > MaxNumRegs)
+            panic("At most %zu physical registers with %d-bit indices\n",
+                  MaxNumRegs, REG_INDEX_BITS);
+    }
+    for (unsigned width : opts.sweep.renameWidths) {
+        if (width == 0)
+            panic("Stage widths must be positive\n");
+    }
+    for (size_t cam : opts.sweep.camSizes) {
+        if (cam == 0)
+            panic("CAM size must be positive\n");
+    }
+    for (size_t size : opts.startupSizes) {
+        if (size > MaxNumRegs)
+            panic("At most %zu registers with %d-bit indices\n",
+                  MaxNumRegs, REG_INDEX_BITS);
+    }
+    if (opts.pipeline.decodeQueueSize == 0)
+        panic("Stage queue capacity must be positive\n");
+    if (opts.banks.numBanks == 0)
+        panic("Need at least one register file bank\n");
+    if (opts.banks.readPorts == 0 || opts.banks.writePorts == 0)
+        panic("Need at least one read and one write port per bank\n");
+    if (opts.movePercent > 100)
+        panic("Move percentage must be at most 100\n");
+    if (opts.pinPercent > 100)
+        panic("Pin percentage must be at most 100\n");
+    opts.pipeline.banks = opts.banks;
+    opts.threaded.banks = opts.banks;
+    opts.pipeline.regCache = opts.regCache;
+    opts.threaded.regCache = opts.regCache;
+    opts.pipeline.moveElimination = opts.eliminateMoves;
+    opts.threaded.moveElimination = opts.eliminateMoves;
+    opts.sweep.pipeline = opts.pipeline;
+    opts.sweep.checkCaps = opts.checkCaps;
+    opts.sweep.checkRead = CheckRead;
+    opts.sweep.checkWrite = CheckWrite;
+}
+
+static void
+getTrace(const Options &opts, std::vector<TraceRecord> &trace)
+{
+    if (!opts.traceFile.empty())
+        loadTrace(opts.traceFile, opts.numArchRegs, trace);
+    else
+        generateTrace(trace, opts.numInsts, opts.numArchRegs, opts.seed,
+                      opts.movePercent, opts.pinPercent);
+}
+
+static double
+secondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * Replay trace on a RenameSim and with fastForward() side by side and
+ * count the architectural registers the two map differently, summed over
+ * the ends of intervals of length records.
+ */
+template <size_t NumArchRegs>
+static size_t
+fastForwardDifferences(const RegClass &reg_class, unsigned num_phys_regs,
+                       const std::vector<TraceRecord> &trace, size_t length)
+{
+    RenameSim sim(reg_class, num_phys_regs);
+    RenameState state = RenameState::initial(NumArchRegs, num_phys_regs);
+    using Map = StaticRenameMap<NumArchRegs, RegIndex>;
+    Map serial, fast;
+    typename Map::Snapshot serial_snap;
+    size_t diffs = 0;
+    for (size_t start = 0; start < trace.size(); start += length) {
+        const TraceRecord *first = trace.data() + start;
+        const TraceRecord *last =
+            trace.data() + std::min(start + length, trace.size());
+        sim.execute(first, last);
+        fastForward(state, first, last);
+
+        const RenameContext &ctx = sim.context();
+        for (RegIndex arch = 0; arch < NumArchRegs; arch++) {
+            serial_snap[arch] =
+                ctx.renameMap.lookup(ctx.archReg(arch))->flatIndex();
         }
+        serial.restore(serial_snap);
+        fast.load(state.archToPhys.data());
+        if (!fast.matches(serial.snapshot()))
+            diffs += fast.countDifferences(serial.snapshot());
     }
+    return diffs;
+}
 
-    void loop() {
-    	cam_map_t::const_iterator it;
-	cout << "Displaying CAM contents now (KEY: VALUE)..." << endl;
-	for (it = m_table.begin(); it != m_table.end(); it++) {
-            cout << it->first
-                 << ": "
-                 << *(it->second)
+static int
+runInterval(const Options &opts)
+{
+    std::vector<TraceRecord> trace;
+    getTrace(opts, trace);
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+
+    auto start = std::chrono::steady_clock::now();
+    SimStats stats = runIntervals(capRegClass, opts.numPhysRegs, trace,
+                                  opts.interval);
+    cout << "interval replay: " << secondsSince(start) << " s" << endl;
+    stats.print(cout);
+
+    if (opts.compare) {
+        start = std::chrono::steady_clock::now();
+        RenameSim sim(capRegClass, opts.numPhysRegs);
+        sim.execute(trace.data(), trace.data() + trace.size());
+        cout << "serial replay: " << secondsSince(start) << " s" << endl;
+        sim.stats().print(cout);
+        const SimStats &serial = sim.stats();
+        bool match = serial.numInsts == stats.numInsts &&
+            serial.numSrcReads == stats.numSrcReads &&
+            serial.numRegWrites == stats.numRegWrites &&
+            serial.readChecksum == stats.readChecksum &&
+            serial.minFreeRegs == stats.minFreeRegs;
+        cout << (match ? "stats match" : "STATS MISMATCH") << endl;
+
+        // Fixed ISA sizes only, where the tables are StaticRenameMaps.
+        const size_t length = std::max<size_t>(1,
+                                               opts.interval.intervalLength);
+        size_t diffs = 0;
+        if (opts.numArchRegs == 32) {
+            diffs = fastForwardDifferences<32>(capRegClass,
+                    opts.numPhysRegs, trace, length);
+        } else if (opts.numArchRegs == 64) {
+            diffs = fastForwardDifferences<64>(capRegClass,
+                    opts.numPhysRegs, trace, length);
+        }
+        if (opts.numArchRegs == 32 || opts.numArchRegs == 64) {
+            cout << (diffs == 0 ? "mappings match" : "MAPPING MISMATCH")
                  << endl;
         }
+        return match && diffs == 0 ? 0 : 1;
+    }
+    return 0;
+}
+
+/** Every register value of ctx, read the way the model reads them. */
+static std::vector<RegVal>
+regValues(const RenameContext &ctx)
+{
+    std::vector<RegVal> values;
+    for (PhysRegIdPtr reg : ctx.physRegs)
+        values.push_back(ctx.regFile.getReg(reg));
+    return values;
+}
+
+/**
+ * Execute the trace on sim in quarters, taking a nested register file
+ * snapshot and a plain copy of the values before each. Afterwards release
+ * the newest snapshot, restore the others newest first and compare each
+ * restored file with its copy.
+ * @return Whether every comparison matched.
+ */
+static bool
+executeCheckingSnapshots(RenameSim &sim,
+                         const std::vector<TraceRecord> &trace)
+{
+    const unsigned parts = 4;
+    PhysRegFile &reg_file = sim.context().regFile;
+    std::vector<std::vector<RegVal>> copies;
+    std::vector<RegFile::SnapshotId> ids;
+    for (unsigned part = 0; part < parts; part++) {
+        ids.push_back(reg_file.snapshot());
+        copies.push_back(regValues(sim.context()));
+        sim.execute(trace.data() + trace.size() * part / parts,
+                    trace.data() + trace.size() * (part + 1) / parts);
+    }
+
+    const std::vector<RegVal> final_values = regValues(sim.context());
+    reg_file.release(ids.back());
+    bool match = regValues(sim.context()) == final_values;
+    for (unsigned part = parts - 1; part-- > 0;) {
+        reg_file.restore(ids[part]);
+        match = match && regValues(sim.context()) == copies[part];
+    }
+    reg_file.release(ids.front());
+    return match && reg_file.numSnapshots() == 0;
+}
+
+static int
+runPipeline(const Options &opts)
+{
+    std::vector<TraceRecord> trace;
+    getTrace(opts, trace);
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+
+    auto start = std::chrono::steady_clock::now();
+    Pipeline pipeline(capRegClass, opts.numPhysRegs, opts.pipeline);
+    setCapChecks(opts, pipeline.context().regFile);
+    pipeline.setTrace(trace.data(), trace.data() + trace.size());
+    pipeline.run();
+    cout << "pipeline: " << secondsSince(start) << " s" << endl;
+    pipeline.stats().print(cout);
+    if (const RegFileBanks *banks = pipeline.regFileBanks()) {
+        banks->print(cout);
+        const std::vector<uint64_t> &allocs =
+            pipeline.context().bankedFreeList->allocations();
+        for (size_t bank = 0; bank < allocs.size(); bank++)
+            cout << "bank" << bank << ".allocs " << allocs[bank] << '\n';
+    }
+    if (const RegCache *cache = pipeline.context().regFile.getRegCache())
+        cache->stats().print(cout);
+    if (const L1Cache *l1 = pipeline.l1Cache())
+        l1->stats().print(cout);
+    const PinnedWrites &pinned =
+        pipeline.context().regFile.getPinnedWrites();
+    if (pinned.stats().pins)
+        pinned.stats().print(cout);
+    printCapChecks(pipeline.context());
+
+    if (opts.compare) {
+        RenameSim sim(capRegClass, opts.numPhysRegs);
+        sim.setMoveElimination(opts.eliminateMoves);
+        // Rolls the register values back afterwards; the stats stay.
+        const bool snapshots_match = executeCheckingSnapshots(sim, trace);
+        bool match = sim.stats().readChecksum ==
+            pipeline.stats().readChecksum;
+        cout << (match ? "values match" : "VALUE MISMATCH") << endl;
+        // The pipeline completes every pinned write before it drains.
+        const bool pins_match = pinned.stats() ==
+            sim.context().regFile.getPinnedWrites().stats();
+        if (pinned.stats().pins || !pins_match) {
+            cout << (pins_match ? "pinned writes match" :
+                     "PINNED WRITE MISMATCH") << endl;
+        }
+        cout << (snapshots_match ? "snapshots match" :
+                 "SNAPSHOT MISMATCH") << endl;
+        return match && pins_match && snapshots_match ? 0 : 1;
+    }
+    return 0;
+}
+
+static int
+runThreaded(const Options &opts)
+{
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+    ThreadedPipeline pipeline(capRegClass, opts.numPhysRegs, opts.threaded);
+    setCapChecks(opts, pipeline.context().regFile);
+    std::vector<TraceRecord> trace;
+
+    auto start = std::chrono::steady_clock::now();
+    if (!opts.traceFile.empty()) {
+        // Decoding the text is part of the pipeline.
+        std::ifstream is(opts.traceFile);
+        if (!is)
+            panic("Cannot open trace %s\n", opts.traceFile.c_str());
+        pipeline.run(is);
+    } else {
+        getTrace(opts, trace);
+        start = std::chrono::steady_clock::now();
+        pipeline.run(trace.data(), trace.data() + trace.size());
+    }
+    cout << "threaded pipeline: " << secondsSince(start) << " s" << endl;
+    pipeline.stats().print(cout);
+    if (const RegCache *cache = pipeline.context().regFile.getRegCache())
+        cache->stats().print(cout);
+    printCapChecks(pipeline.context());
+
+    if (opts.compare) {
+        if (trace.empty())
+            getTrace(opts, trace);
+        RenameSim sim(capRegClass, opts.numPhysRegs);
+        sim.setMoveElimination(opts.eliminateMoves);
+        sim.execute(trace.data(), trace.data() + trace.size());
+        bool match = sim.stats().readChecksum ==
+            pipeline.stats().readChecksum &&
+            sim.stats().numInsts == pipeline.stats().numInsts;
+        cout << (match ? "values match" : "VALUE MISMATCH") << endl;
+        return match ? 0 : 1;
+    }
+    return 0;
+}
+
+static int
+runSweep(const Options &opts)
+{
+    std::vector<TraceRecord> trace;
+    getTrace(opts, trace);
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<SweepResult> results =
+        workflow::runSweep(capRegClass, trace, opts.sweep);
+    cerr << "sweep: " << results.size() << " points in "
+         << secondsSince(start) << " s" << endl;
+    SweepResult::printCSVHeader(cout);
+    for (const SweepResult &result : results)
+        result.printCSV(cout);
+    return 0;
+}
+
+static int
+runAnalyze(const Options &opts)
+{
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+    RenameContext ctx(capRegClass, opts.numPhysRegs);
+    DependencyAnalyzer analyzer(opts.numArchRegs, opts.numPhysRegs,
+                                opts.latency);
+
+    auto analyze = [&](const TraceRecord &rec) {
+        PhysRegIdPtr srcs[TraceRecord::MaxSrcRegs];
+        for (unsigned s = 0; s < rec.numSrcs; s++)
+            srcs[s] = ctx.renameMap.lookup(ctx.archReg(rec.srcs[s]));
+        RenameMap::RenameInfo info = ctx.renameDest(rec);
+        analyzer.record(rec, srcs, info);
+        if (ctx.freesPrev(info))
+            ctx.releaseReg(info.second);
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    if (!opts.traceFile.empty()) {
+        // Stream the trace; it need not fit in memory.
+        std::ifstream is(opts.traceFile);
+        if (!is)
+            panic("Cannot open trace %s\n", opts.traceFile.c_str());
+        TraceReader reader(is, opts.numArchRegs);
+        TraceRecord rec;
+        while (reader.next(rec))
+            analyze(rec);
+    } else {
+        std::vector<TraceRecord> trace;
+        getTrace(opts, trace);
+        start = std::chrono::steady_clock::now();
+        for (const TraceRecord &rec : trace)
+            analyze(rec);
+    }
+    cout << "analysis: " << secondsSince(start) << " s" << endl;
+    analyzer.stats().print(cout);
+    return 0;
+}
+
+/**
+ * Replay the trace's writes into a ConcurrentCAM, mapping each value to
+ * its destination register, while reader threads look the values up.
+ * Every register a reader finds must be one the value was written with,
+ * and the final contents must match a CAM given the same accepted writes.
+ */
+static int
+runConcurrentCam(const Options &opts)
+{
+    std::vector<TraceRecord> trace;
+    getTrace(opts, trace);
+    RegClass capRegClass(CapRegClass, CapRegClassName, opts.numArchRegs,
+                         debug::CapRegs);
+    std::vector<RegId> archRegs(capRegClass.begin(), capRegClass.end());
+
+    // The registers each value is written with, for the readers' check.
+    std::unordered_map<Addr, std::vector<RegIndex>> writes;
+    for (const TraceRecord &rec : trace) {
+        if (rec.isMove)
+            continue;
+        std::vector<RegIndex> &dests = writes[rec.value];
+        if (std::find(dests.begin(), dests.end(), rec.dest) == dests.end())
+            dests.push_back(rec.dest);
     }
 
-    // given the key, find value
-    RegIdPtr find( int key ) {
-        cam_map_t::const_iterator it = m_table.find( key );
-        if (it == m_table.end()) {
-            return nullptr; // handle at the caller
-        } else {
-            return it->second;
+    const size_t size = opts.sweep.camSizes.front();
+    ConcurrentCAM ccam(size);
+    // Twice the room, so only ConcurrentCAM ever refuses a key.
+    CAM ref(2 * size);
+
+    unsigned num_readers = opts.interval.numThreads;
+    if (num_readers == 0)
+        num_readers = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    std::atomic<bool> writing{true};
+    std::vector<uint64_t> lookups(num_readers), hits(num_readers);
+    std::vector<uint64_t> bad(num_readers);
+    auto reader = [&](unsigned id) {
+        // Start readers at different records; each makes at least one
+        // pass and keeps going while the writer runs.
+        size_t i = trace.size() * id / num_readers;
+        size_t left = trace.size();
+        while (left || writing.load(std::memory_order_relaxed)) {
+            left -= left != 0;
+            const TraceRecord &rec = trace[i];
+            i = i + 1 == trace.size() ? 0 : i + 1;
+            if (rec.isMove)
+                continue;
+            lookups[id]++;
+            RegIdPtr reg = ccam.find(rec.value);
+            if (!reg)
+                continue;
+            hits[id]++;
+            const std::vector<RegIndex> &dests = writes.at(rec.value);
+            const size_t idx = reg - archRegs.data();
+            bad[id] += idx >= archRegs.size() ||
+                std::find(dests.begin(), dests.end(), idx) == dests.end();
         }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> readers;
+    for (unsigned id = 0; id < num_readers; id++)
+        readers.emplace_back(reader, id);
+    uint64_t refused = 0;
+    uint64_t status_mismatches = 0;
+    for (const TraceRecord &rec : trace) {
+        if (rec.isMove)
+            continue;
+        CAMInsertResult res = ccam.add(rec.value, &archRegs[rec.dest]);
+        if (!res.ok()) {
+            refused++;
+            continue;
+        }
+        status_mismatches +=
+            ref.add(rec.value, &archRegs[rec.dest]).status != res.status;
     }
-  private:
-    cam_map_t m_table;
-};
+    const double write_secs = secondsSince(start);
+    writing.store(false, std::memory_order_relaxed);
+    for (std::thread &t : readers)
+        t.join();
+    const double secs = secondsSince(start);
 
-uint32_t getCacheLineNumber(uint32_t cap) {
-    // for l1 cache, max no. of cache blocks = 2^9 = 512.
-    return (((1 << 9) - 1) & (cap >> (9 - 1)));
+    uint64_t total_lookups = 0, total_hits = 0, total_bad = 0;
+    for (unsigned id = 0; id < num_readers; id++) {
+        total_lookups += lookups[id];
+        total_hits += hits[id];
+        total_bad += bad[id];
+    }
+    uint64_t content_mismatches = ccam.size() != ref.size();
+    for (const auto &kv : writes)
+        content_mismatches += ccam.find(kv.first) != ref.find(kv.first);
+
+    cout << "concurrent cam: " << num_readers << " readers, "
+         << total_lookups << " lookups in " << secs << " s ("
+         << total_lookups / secs / 1e6 << " M/s), writer "
+         << write_secs << " s" << endl;
+    cout << "entries " << ccam.size() << " refused " << refused
+         << " hits " << total_hits << endl;
+    const bool valid = total_bad == 0;
+    cout << (valid ? "lookups valid" : "INVALID LOOKUP") << endl;
+    const bool match = status_mismatches == 0 && content_mismatches == 0;
+    cout << (match ? "contents match" : "CONTENTS MISMATCH") << endl;
+    return valid && match ? 0 : 1;
 }
 
-/* i is the cache line number */
-uint32_t constructCapability(int i) {
-    // assuming non-secure class of service
-    // and a first-level cache
-    uint32_t access_rights = 0b00011111;
-    uint32_t cache_level = 0b01;
-    return cache_level << 17 | (i << 8 | access_rights);
+/** CAM entries mapping key i to arch_regs[i], as in the demo. */
+static std::vector<std::pair<Addr, RegIdPtr>>
+camEntries(std::vector<RegId> &arch_regs)
+{
+    std::vector<std::pair<Addr, RegIdPtr>> entries(arch_regs.size());
+    for (size_t i = 0; i < arch_regs.size(); i++)
+        entries[i] = {i, &arch_regs[i]};
+    return entries;
 }
 
-int main() {
+/**
+ * The demo setup of the given size built one element at a time, as
+ * main() used to: a new RegId per CAM add(), the physical register ids
+ * emplaced without reserving, a free list push per register and a
+ * setEntry() per mapping. The RegIds are released after the clock stops.
+ * @param first Set to the physical register of the first rename.
+ * @return The setup time in seconds.
+ */
+static double
+startupPerElement(const RegClass &reg_class, size_t size, RegIndex &first)
+{
+    const auto start = std::chrono::steady_clock::now();
+    CAM cam(size);
+    for (size_t i = 0; i < size; i++)
+        cam.add(i, new RegId(reg_class, i));
+    std::vector<PhysRegId> phys_regs;
+    for (size_t i = 0; i < size; i++)
+        phys_regs.emplace_back(reg_class, i, i);
+    SimpleFreeList freeList;
+    for (PhysRegId &reg : phys_regs)
+        freeList.addReg(&reg);
+    RenameMap rmap;
+    rmap.init(reg_class, &freeList);
+    for (size_t i = 0; i < size / 4; i++)
+        rmap.setEntry(*cam.find(i), freeList.getReg());
+    first = rmap.rename(*cam.find(0)).first->flatIndex();
+    const double secs = secondsSince(start);
+
+    for (size_t i = 0; i < size; i++)
+        delete cam.find(i);
+    return secs;
+}
+
+/**
+ * startupPerElement() with the bulk constructors, over CAM entries
+ * built beforehand from the caller's arch RegIds.
+ */
+static double
+startupBulk(const RegClass &reg_class,
+            const std::vector<std::pair<Addr, RegIdPtr>> &entries,
+            RegIndex &first)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const size_t size = entries.size();
+    CAM cam(entries.begin(), entries.end(), size);
+    std::vector<PhysRegId> phys_regs;
+    phys_regs.reserve(size);
+    for (size_t i = 0; i < size; i++)
+        phys_regs.emplace_back(reg_class, i, i);
+    SimpleFreeList freeList(phys_regs.begin() + size / 4, phys_regs.end());
+    RenameMap rmap;
+    rmap.initIdentity(reg_class, &freeList, phys_regs.data(), size / 4);
+    first = rmap.rename(*cam.find(0)).first->flatIndex();
+    return secondsSince(start);
+}
+
+static int
+runStartup(const Options &opts)
+{
+    // Best of several runs, each from scratch.
+    const unsigned reps = 20;
+    cout << "size,per_element_us,bulk_us,speedup" << endl;
+    for (size_t size : opts.startupSizes) {
+        if (size < 4)
+            panic("Startup sizes must be at least 4\n");
+        RegClass capRegClass(CapRegClass, CapRegClassName, size,
+                             debug::CapRegs);
+        std::vector<RegId> arch_regs(capRegClass.begin(), capRegClass.end());
+        const std::vector<std::pair<Addr, RegIdPtr>> entries =
+            camEntries(arch_regs);
+        double per_element = 1e30;
+        double bulk = 1e30;
+        for (unsigned rep = 0; rep < reps; rep++) {
+            RegIndex first, bulk_first;
+            per_element = std::min(per_element,
+                    startupPerElement(capRegClass, size, first));
+            bulk = std::min(bulk,
+                    startupBulk(capRegClass, entries, bulk_first));
+            if (bulk_first != first)
+                panic("Bulk setup renamed to another register\n");
+        }
+        cout << size << ',' << per_element * 1e6 << ',' << bulk * 1e6 << ','
+             << per_element / bulk << endl;
+    }
+    return 0;
+}
+
+static int
+runDemo()
+{
+    // print every rename
+    debug::Flag::globalEnable();
+    debug::findFlag("CapRegs")->enable();
 
     CAM cam{};
-    // RegIndex is uint16_t //
-    uint16_t size = cam.getMaxSize();
+    const RegIndex size = cam.getMaxSize();
 
     RegClass capRegClass(CapRegClass, "capability", size, debug::CapRegs);
-    RegIndex i{0};
-    RegIdPtr reg;
-    for (i = 0; i < size; i++) {
-        cam.add(i, new RegId(capRegClass, i));
-    }
+    std::vector<RegId> archRegs(capRegClass.begin(), capRegClass.end());
+    std::vector<std::pair<Addr, RegIdPtr>> entries = camEntries(archRegs);
+    for (const auto &entry : cam.addRange(entries.begin(), entries.end()))
+        cout << "CAM is full. Cannot add " << *entry.second << "!" << endl;
     // Check all values
     cam.loop();
     // define free list of cap registers
@@ -93,26 +886,22 @@ int main() {
 
     PhysRegIdPtr physReg;
 
-    PhysRegFile::IdRange capIdRange = regFile.getCapRegIds();
-
-    freeList.addRegs(capIdRange.first, capIdRange.second);
     // do some renaming (map arch register to physical register)
     RenameMap rmap{};
-    // associate free list of physical registers to rename map
-    rmap.init(capRegClass, &freeList);
-    // have an initial mapping of architectural regs to physical regs
-    // we can rename later
-    for (auto i = 0; i < size/4; i++) {
-        rmap.setEntry(*cam.find(i), freeList.getReg());
-    }
+    // associate free list of physical registers to rename map, with an
+    // initial mapping of architectural regs to physical regs we can
+    // rename later; the other registers start free
+    rmap.initIdentity(capRegClass, &freeList,
+                      &*regFile.getCapRegIds().first, size, size/4);
+    rmap.setPinnedWrites(&regFile.getPinnedWrites());
 
     // demonstrate rename now
 
-    for (auto i = 0; i < size/4; i++) {
+    for (RegIndex i = 0; i < size/4; i++) {
         rmap.rename(*cam.find(i));
     }
     // insert capability (load capability values into register)
-    for (auto i = 0; i < size/4; i++) {
+    for (RegIndex i = 0; i < size/4; i++) {
         physReg = rmap.lookup(*cam.find(i));
         uint32_t cap = constructCapability(i);
         regFile.setReg(physReg, cap);
@@ -120,7 +909,7 @@ int main() {
 
     // check capability (read capability values from register)
 
-    for (auto i = 0; i < size/4; i++) {
+    for (RegIndex i = 0; i < size/4; i++) {
         physReg = rmap.lookup(*cam.find(i));
         cout << "Capability value stored in physical register "
              << physReg->flatIndex()
@@ -128,19 +917,47 @@ int main() {
              << " is " << regFile.getReg(physReg) << endl;
     }
     // get line number (get cache line number from register)
-    for (auto i = 0; i < size/4; i++) {
+    for (RegIndex i = 0; i < size/4; i++) {
         physReg = rmap.lookup(*cam.find(i));
         cout << "Cache line number mapped to capability value "
              << regFile.getReg(physReg) << " is " 
              << getCacheLineNumber(regFile.getReg(physReg)) << endl;
     }
-    // free architectural registers in CAM
-    for (auto i = 0; i < size; i++) {
-        reg = cam.find(i);
-        if (reg != nullptr)
-	    delete reg;
-    }
     // bye!
     cout << "\nBye!" << endl;
     return 0;
 }
+
+int
+main(int argc, char **argv)
+{
+    progName = argv[0];
+    const std::string mode = argc > 1 ? argv[1] : "demo";
+    Options opts;
+    parseOptions(argc - 1, argv + 1, opts);
+
+    int ret;
+    if (mode == "demo") {
+        ret = runDemo();
+    } else if (mode == "interval") {
+        ret = runInterval(opts);
+    } else if (mode == "pipeline") {
+        ret = runPipeline(opts);
+    } else if (mode == "threaded") {
+        ret = runThreaded(opts);
+    } else if (mode == "sweep") {
+        ret = runSweep(opts);
+    } else if (mode == "analyze") {
+        ret = runAnalyze(opts);
+    } else if (mode == "startup") {
+        ret = runStartup(opts);
+    } else if (mode == "cam") {
+        ret = runConcurrentCam(opts);
+    } else {
+        usage();
+        return 1;
+    }
+    if (PROBES)
+        printProbes(cerr);
+    return ret;
+}
@@ -0,0 +1,68 @@
+#include "page_buffer.hh"
+
+#include <cstdint>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "debug.hh"
+
+namespace workflow
+{
+
+namespace
+{
+
+constexpr size_t HugePageBytes = size_t(2) << 20;
+
+} // anonymous namespace
+
+PageAllocOptions &
+pageAllocOptions()
+{
+    static PageAllocOptions opts;
+    return opts;
+}
+
+void *
+mapPages(size_t bytes, bool huge)
+{
+    // Over-map by a huge page so the region can start on a boundary.
+    const size_t len = huge ? bytes + HugePageBytes : bytes;
+    void *addr = mmap(nullptr, len, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (addr == MAP_FAILED)
+        panic("Cannot map %zu bytes\n", bytes);
+    if (!huge)
+        return addr;
+
+    const uintptr_t start = reinterpret_cast<uintptr_t>(addr);
+    const uintptr_t aligned =
+        (start + HugePageBytes - 1) & ~(uintptr_t(HugePageBytes) - 1);
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const uintptr_t end = (aligned + bytes + page - 1) & ~(page - 1);
+    if (aligned != start)
+        munmap(addr, aligned - start);
+    if (start + len != end)
+        munmap(reinterpret_cast<void *>(end), start + len - end);
+    // Only a hint; without THP the region stays in small pages.
+    madvise(reinterpret_cast<void *>(aligned), end - aligned,
+            MADV_HUGEPAGE);
+    return reinterpret_cast<void *>(aligned);
+}
+
+void
+unmapPages(void *addr, size_t bytes)
+{
+    munmap(addr, bytes);
+}
+
+void
+discardPages(void *addr, size_t bytes)
+{
+    if (madvise(addr, bytes, MADV_DONTNEED) != 0)
+        std::memset(addr, 0, bytes);
+}
+
+} // namespace workflow
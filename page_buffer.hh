@@ -0,0 +1,156 @@
+#ifndef __PAGE_BUFFER_HH__
+#define __PAGE_BUFFER_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace workflow
+{
+
+/** How PageBuffers obtain their memory; read when a buffer allocates. */
+struct PageAllocOptions
+{
+    /** Map buffers of at least mmapThreshold bytes directly. */
+    bool mmap = true;
+    size_t mmapThreshold = 64 * 1024;
+    /** Ask for transparent huge pages on mapped buffers. */
+    bool hugePages = false;
+};
+
+PageAllocOptions &pageAllocOptions();
+
+/**
+ * Map bytes of anonymous, demand-zero memory, aligned to a huge page and
+ * advised as huge page backed if huge is set.
+ */
+void *mapPages(size_t bytes, bool huge);
+void unmapPages(void *addr, size_t bytes);
+/** Return the pages of a mapping to the kernel; they read as zero. */
+void discardPages(void *addr, size_t bytes);
+
+/**
+ * Fixed-size array of trivially copyable T, zero-initialized, for large
+ * simulator tables. T must be valid when all of its bytes are zero.
+ *
+ * Large buffers are anonymous mappings, so they cost nothing to create:
+ * pages are zero-filled by the kernel on first touch, and zero() hands
+ * them back with MADV_DONTNEED instead of writing them. Small buffers
+ * come from the heap and are cleared with memset.
+ */
+template <class T>
+class PageBuffer
+{
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "PageBuffer holds trivially copyable types only");
+
+  private:
+    T *_data = nullptr;
+    size_t _size = 0;
+    bool mapped = false;
+
+    size_t bytes() const { return _size * sizeof(T); }
+
+    void
+    release()
+    {
+        if (!_data)
+            return;
+        if (mapped) {
+            unmapPages(_data, bytes());
+        } else {
+            ::operator delete(_data, std::align_val_t(alignof(T)));
+        }
+        _data = nullptr;
+        _size = 0;
+    }
+
+  public:
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    PageBuffer() {}
+    explicit PageBuffer(size_t n) { reset(n); }
+    ~PageBuffer() { release(); }
+
+    PageBuffer(const PageBuffer &) = delete;
+    PageBuffer &operator=(const PageBuffer &) = delete;
+
+    PageBuffer(PageBuffer &&other) { *this = std::move(other); }
+
+    PageBuffer &
+    operator=(PageBuffer &&other)
+    {
+        if (this != &other) {
+            release();
+            std::swap(_data, other._data);
+            std::swap(_size, other._size);
+            std::swap(mapped, other.mapped);
+        }
+        return *this;
+    }
+
+    /** Replace the contents with n zeroed elements. */
+    void
+    reset(size_t n)
+    {
+        release();
+        if (n == 0)
+            return;
+        const PageAllocOptions &opts = pageAllocOptions();
+        _size = n;
+        mapped = opts.mmap && bytes() >= opts.mmapThreshold;
+        if (mapped) {
+            _data = static_cast<T *>(mapPages(bytes(), opts.hugePages));
+        } else {
+            _data = static_cast<T *>(::operator new(
+                        bytes(), std::align_val_t(alignof(T))));
+            std::memset(static_cast<void *>(_data), 0, bytes());
+        }
+    }
+
+    /** Set every element to zero. O(1) in touched memory if mapped. */
+    void
+    zero()
+    {
+        if (mapped)
+            discardPages(_data, bytes());
+        else if (_data)
+            std::memset(static_cast<void *>(_data), 0, bytes());
+    }
+
+    size_t size() const { return _size; }
+    bool empty() const { return _size == 0; }
+    bool isMapped() const { return mapped; }
+
+    T *data() { return _data; }
+    const T *data() const { return _data; }
+
+    T &
+    operator[](size_t i)
+    {
+        assert(i < _size);
+        return _data[i];
+    }
+
+    const T &
+    operator[](size_t i) const
+    {
+        assert(i < _size);
+        return _data[i];
+    }
+
+    iterator begin() { return _data; }
+    iterator end() { return _data + _size; }
+    const_iterator begin() const { return _data; }
+    const_iterator end() const { return _data + _size; }
+    const_iterator cbegin() const { return _data; }
+    const_iterator cend() const { return _data + _size; }
+};
+
+} // namespace workflow
+
+#endif // __PAGE_BUFFER_HH__
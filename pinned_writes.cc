@@ -0,0 +1,81 @@
+#include "pinned_writes.hh"
+
+#include <algorithm>
+#include <cassert>
+
+#include "debug.hh"
+
+namespace workflow
+{
+
+void
+PinnedWriteStats::print(std::ostream &os) const
+{
+    os << "pinned.pins " << pins << '\n'
+       << "pinned.reuses " << reuses << '\n'
+       << "pinned.completedWrites " << completedWrites << '\n'
+       << "pinned.unpins " << unpins << '\n';
+}
+
+PinnedWrites::PinnedWrites(size_t num_regs)
+    : renamesLeft(num_regs, 0), writesLeft(num_regs, 0),
+      reuseBits((num_regs + 63) / 64, 0),
+      pinnedBits((num_regs + 63) / 64, 0)
+{}
+
+void
+PinnedWrites::pin(RegIndex flat, unsigned num_writes)
+{
+    if (num_writes == 0)
+        return;
+    if (num_writes >= UINT16_MAX)
+        panic("Too many pinned writes: %u\n", num_writes);
+    setPinned(flat, num_writes, num_writes + 1);
+    _stats.pins++;
+}
+
+void
+PinnedWrites::setPinned(RegIndex flat, unsigned num_renames,
+                        unsigned num_writes)
+{
+    assert(num_renames <= num_writes);
+    numPinnedRegs += (num_writes != 0) - isPinned(flat);
+    renamesLeft[flat] = num_renames;
+    writesLeft[flat] = num_writes;
+    setBit(reuseBits, flat, num_renames != 0);
+    setBit(pinnedBits, flat, num_writes != 0);
+}
+
+size_t
+PinnedWrites::completeWrites(const RegIndex *flats, size_t n)
+{
+    size_t unpinned = 0;
+    size_t completed = 0;
+    for (size_t i = 0; i < n; i++) {
+        const RegIndex flat = flats[i];
+        const uint16_t left = writesLeft[flat];
+        const bool pinned = left != 0;
+        const bool last = left == 1;
+        writesLeft[flat] = left - pinned;
+        // Only the last write clears the bit; others leave it set.
+        pinnedBits[flat >> 6] &= ~(uint64_t(last) << (flat & 63));
+        completed += pinned;
+        unpinned += last;
+    }
+    numPinnedRegs -= unpinned;
+    _stats.completedWrites += completed;
+    _stats.unpins += unpinned;
+    return unpinned;
+}
+
+void
+PinnedWrites::clear()
+{
+    std::fill(renamesLeft.begin(), renamesLeft.end(), 0);
+    std::fill(writesLeft.begin(), writesLeft.end(), 0);
+    std::fill(reuseBits.begin(), reuseBits.end(), 0);
+    std::fill(pinnedBits.begin(), pinnedBits.end(), 0);
+    numPinnedRegs = 0;
+}
+
+} // namespace workflow
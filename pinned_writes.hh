@@ -0,0 +1,131 @@
+#ifndef __PINNED_WRITES_HH__
+#define __PINNED_WRITES_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "reg_class.hh"
+
+namespace workflow
+{
+
+struct PinnedWriteStats
+{
+    /** Registers pinned, and renames that reused a pinned register. */
+    uint64_t pins = 0;
+    uint64_t reuses = 0;
+    /** Writes completed to pinned registers. */
+    uint64_t completedWrites = 0;
+    /** Registers whose last pinned write completed. */
+    uint64_t unpins = 0;
+
+    bool
+    operator==(const PinnedWriteStats &other) const
+    {
+        return pins == other.pins && reuses == other.reuses &&
+            completedWrites == other.completedWrites &&
+            unpins == other.unpins;
+    }
+
+    void print(std::ostream &os) const;
+};
+
+/**
+ * Pinned-write state of every physical register, by flat index.
+ *
+ * An instruction writing a register several times in parts, such as a
+ * vector-like multi-write, pins its destination: the first rename
+ * allocates a register and the next num_writes renames of the same
+ * architectural register reuse it. The register stays pinned until all
+ * num_writes + 1 writes have completed.
+ *
+ * The counters live in dense arrays rather than in each PhysRegId, and
+ * two bitmaps mirror them: one bit per register that rename must reuse,
+ * so rename tests one word, and one per register still pinned.
+ */
+class PinnedWrites
+{
+  private:
+    /** Renames still to reuse each register. */
+    std::vector<uint16_t> renamesLeft;
+    /** Writes still to complete to each register. */
+    std::vector<uint16_t> writesLeft;
+    /** Bit per register: renamesLeft is non-zero. */
+    std::vector<uint64_t> reuseBits;
+    /** Bit per register: writesLeft is non-zero. */
+    std::vector<uint64_t> pinnedBits;
+    /** Registers with a bit set in pinnedBits. */
+    size_t numPinnedRegs = 0;
+
+    PinnedWriteStats _stats;
+
+    static bool
+    testBit(const std::vector<uint64_t> &bits, RegIndex flat)
+    {
+        return (bits[flat >> 6] >> (flat & 63)) & 1;
+    }
+
+    static void
+    setBit(std::vector<uint64_t> &bits, RegIndex flat, bool value)
+    {
+        const uint64_t mask = uint64_t(1) << (flat & 63);
+        bits[flat >> 6] =
+            (bits[flat >> 6] & ~mask) | (-uint64_t(value) & mask);
+    }
+
+  public:
+    explicit PinnedWrites(size_t num_regs);
+
+    size_t numRegs() const { return renamesLeft.size(); }
+
+    /** True iff renaming a mapping of flat must reuse it. */
+    bool mustReuse(RegIndex flat) const { return testBit(reuseBits, flat); }
+
+    /** True iff flat has pinned writes left to complete. */
+    bool isPinned(RegIndex flat) const { return testBit(pinnedBits, flat); }
+
+    /** True iff any register is pinned. */
+    bool anyPinned() const { return numPinnedRegs != 0; }
+    size_t numPinned() const { return numPinnedRegs; }
+
+    unsigned numRenamesLeft(RegIndex flat) const { return renamesLeft[flat]; }
+    unsigned numWritesLeft(RegIndex flat) const { return writesLeft[flat]; }
+
+    /**
+     * Pin a newly allocated register for num_writes further renames;
+     * does nothing if num_writes is 0.
+     */
+    void pin(RegIndex flat, unsigned num_writes);
+
+    /**
+     * Set the counters of flat, as saved from another instance; both 0
+     * unpins it. Not counted as a pin.
+     */
+    void setPinned(RegIndex flat, unsigned num_renames, unsigned num_writes);
+
+    /** A rename reused flat, which mustReuse(). */
+    void
+    reuse(RegIndex flat)
+    {
+        setBit(reuseBits, flat, --renamesLeft[flat] != 0);
+        _stats.reuses++;
+    }
+
+    /**
+     * Complete one write to each of the n registers in flats; writes to
+     * unpinned registers are ignored. Branch free per register.
+     * @return The number of registers unpinned by these writes.
+     */
+    size_t completeWrites(const RegIndex *flats, size_t n);
+
+    /** Unpin every register. */
+    void clear();
+
+    const PinnedWriteStats &stats() const { return _stats; }
+};
+
+} // namespace workflow
+
+#endif // __PINNED_WRITES_HH__
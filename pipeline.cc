@@ -0,0 +1,234 @@
+#include "pipeline.hh"
+
+#include <cassert>
+
+namespace workflow
+{
+
+void
+PipelineBaseStats::print(std::ostream &os) const
+{
+    os << "regReads " << regReads << '\n'
+       << "regWrites " << regWrites << '\n'
+       << "moves " << moves << '\n'
+       << "eliminatedMoves " << eliminatedMoves << '\n'
+       << "readChecksum 0x" << std::hex << readChecksum << std::dec
+       << '\n';
+}
+
+void
+PipelineStats::print(std::ostream &os) const
+{
+    os << "cycles " << cycles << '\n'
+       << "decodedInsts " << decodedInsts << '\n'
+       << "renamedInsts " << renamedInsts << '\n'
+       << "dispatchedInsts " << dispatchedInsts << '\n'
+       << "ipc " << ipc() << '\n';
+    PipelineBaseStats::print(os);
+    os << "decodeQueueFullCycles " << decodeQueueFullCycles << '\n'
+       << "freeListEmptyCycles " << freeListEmptyCycles << '\n'
+       << "renameQueueFullCycles " << renameQueueFullCycles << '\n'
+       << "renameIdleCycles " << renameIdleCycles << '\n'
+       << "portConflictCycles " << portConflictCycles << '\n'
+       << "scoreboardStallCycles " << scoreboardStallCycles << '\n'
+       << "events " << events << '\n'
+       << "avgFreeRegs " << avgFreeRegs() << '\n'
+       << "avgRenameQueue " << avgRenameQueue() << '\n';
+}
+
+Pipeline::Pipeline(const RegClass &reg_class, unsigned num_phys_regs,
+                   const PipelineConfig &_config)
+    : config(_config), ctx(reg_class, num_phys_regs, _config.banks),
+      decodeQueue(_config.decodeQueueSize),
+      renameQueue(_config.renameQueueSize),
+      delayed(_config.writeLatency || _config.freeLatency),
+      regWritesRenamed(num_phys_regs, 0),
+      regWritesDone(num_phys_regs, 0)
+{
+    if (config.banks.banked())
+        banks = std::make_unique<RegFileBanks>(config.banks, num_phys_regs);
+    if (config.l1.enabled())
+        l1 = std::make_unique<L1Cache>(config.l1);
+    ctx.regFile.setRegCache(config.regCache);
+    ctx.setMoveElimination(config.moveElimination);
+}
+
+void
+Pipeline::decode()
+{
+    for (unsigned i = 0; i < config.decodeWidth; i++) {
+        if (traceNext == traceEnd)
+            return;
+        if (decodeQueue.full()) {
+            _stats.decodeQueueFullCycles++;
+            return;
+        }
+        decodeQueue.push(*traceNext++);
+        _stats.decodedInsts++;
+    }
+}
+
+void
+Pipeline::rename()
+{
+    if (decodeQueue.empty()) {
+        _stats.renameIdleCycles++;
+        return;
+    }
+    for (unsigned i = 0; i < config.renameWidth; i++) {
+        if (decodeQueue.empty())
+            return;
+        if (renameQueue.full()) {
+            _stats.renameQueueFullCycles++;
+            return;
+        }
+        const TraceRecord &rec = decodeQueue.front();
+        const bool eliminate = ctx.eliminates(rec);
+        if (!eliminate && !ctx.hasFreeRegs()) {
+            _stats.freeListEmptyCycles++;
+            return;
+        }
+
+        RenamedInst &inst = renameQueue.pushBack();
+        inst.isMove = rec.isMove;
+        inst.eliminated = eliminate;
+        inst.numSrcs = eliminate ? 0 : rec.numSrcs;
+        for (unsigned s = 0; s < inst.numSrcs; s++) {
+            inst.srcs[s] =
+                ctx.renameMap.lookup(ctx.archReg(rec.srcs[s]));
+            inst.srcWrites[s] = regWritesRenamed[inst.srcs[s]->flatIndex()];
+        }
+        RenameMap::RenameInfo info = ctx.renameDest(rec);
+        inst.dest = info.first;
+        inst.prevDest = ctx.freesPrev(info) ? info.second : nullptr;
+        inst.value = rec.value;
+        if (config.writeLatency && !eliminate)
+            regWritesRenamed[inst.dest->flatIndex()]++;
+        _stats.moves += rec.isMove;
+        _stats.eliminatedMoves += eliminate;
+        decodeQueue.pop();
+        _stats.renamedInsts++;
+    }
+}
+
+void
+Pipeline::dispatch()
+{
+    for (unsigned i = 0; i < config.dispatchWidth; i++) {
+        if (renameQueue.empty())
+            return;
+        const RenamedInst &inst = renameQueue.front();
+        if (config.writeLatency && !srcsReady(inst)) {
+            _stats.scoreboardStallCycles++;
+            return;
+        }
+        if (banks && !inst.eliminated &&
+            !banks->reserve(inst.srcs, inst.numSrcs, inst.dest)) {
+            _stats.portConflictCycles++;
+            return;
+        }
+        RegVal src_values[TraceRecord::MaxSrcRegs];
+        for (unsigned s = 0; s < inst.numSrcs; s++) {
+            src_values[s] = ctx.regFile.getReg(inst.srcs[s]);
+            _stats.readChecksum += src_values[s];
+        }
+        _stats.regReads += inst.numSrcs;
+        if (l1)
+            l1->accessCaps(src_values, inst.numSrcs, false);
+        const RegVal value = inst.isMove ? src_values[0] : inst.value;
+        _stats.regWrites += !inst.eliminated;
+        if (delayed) {
+            scheduleCompletion(inst, value);
+        } else {
+            if (!inst.eliminated)
+                writeReg(inst.dest, value);
+            if (inst.prevDest)
+                ctx.releaseReg(inst.prevDest);
+        }
+        renameQueue.pop();
+        _stats.dispatchedInsts++;
+    }
+}
+
+void
+Pipeline::scheduleCompletion(const RenamedInst &inst, RegVal value)
+{
+    if (inst.eliminated) {
+        // Nothing to write; the previous mapping still waits its turn.
+    } else if (config.writeLatency) {
+        events.schedule(config.writeLatency,
+                        {Event::WriteReg, inst.dest, value});
+    } else {
+        writeReg(inst.dest, value);
+    }
+    if (inst.prevDest) {
+        events.schedule(config.writeLatency + config.freeLatency,
+                        {Event::FreeReg, inst.prevDest, 0});
+    }
+}
+
+void
+Pipeline::complete(const Event &event)
+{
+    if (event.type == Event::WriteReg) {
+        writeReg(event.reg, event.value);
+        regWritesDone[event.reg->flatIndex()]++;
+    } else {
+        ctx.releaseReg(event.reg);
+    }
+    _stats.events++;
+}
+
+void
+Pipeline::tick()
+{
+    // Writes and frees due now land before any stage looks at them.
+    if (delayed)
+        events.service([this](const Event &event) { complete(event); });
+    // Back to front: each stage sees the queue space its consumer
+    // freed this cycle, but never an instruction produced this cycle.
+    if (banks)
+        banks->newCycle();
+    dispatch();
+    if (!pinnedWrites.empty()) {
+        ctx.regFile.getPinnedWrites().completeWrites(pinnedWrites.data(),
+                                                     pinnedWrites.size());
+        pinnedWrites.clear();
+    }
+    rename();
+    decode();
+    _stats.freeRegsSum += ctx.numFreeRegs();
+    _stats.renameQueueSum += renameQueue.size();
+    _stats.cycles++;
+    if (delayed)
+        events.advance();
+}
+
+void
+Pipeline::reset(const PipelineConfig &_config, const RenameState &state)
+{
+    assert(_config.banks.numBanks == config.banks.numBanks &&
+           _config.banks.mapping == config.banks.mapping);
+    config = _config;
+    delayed = config.writeLatency || config.freeLatency;
+    ctx.regFile.setRegCache(config.regCache);
+    ctx.loadState(state);
+    ctx.setMoveElimination(config.moveElimination);
+    if (config.banks.banked()) {
+        banks = std::make_unique<RegFileBanks>(config.banks,
+                                               ctx.physRegs.size());
+    }
+    l1.reset();
+    if (config.l1.enabled())
+        l1 = std::make_unique<L1Cache>(config.l1);
+    decodeQueue.resize(config.decodeQueueSize);
+    renameQueue.resize(config.renameQueueSize);
+    events.clear();
+    pinnedWrites.clear();
+    regWritesRenamed.assign(ctx.physRegs.size(), 0);
+    regWritesDone.assign(ctx.physRegs.size(), 0);
+    traceNext = traceEnd = nullptr;
+    resetStats();
+}
+
+} // namespace workflow
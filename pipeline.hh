@@ -0,0 +1,286 @@
+#ifndef __PIPELINE_HH__
+#define __PIPELINE_HH__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "l1_cache.hh"
+#include "reg_cache.hh"
+#include "regfile_banked.hh"
+#include "rename_sim.hh"
+#include "ring_buffer.hh"
+#include "timing_wheel.hh"
+#include "trace.hh"
+
+namespace workflow
+{
+
+/** Settings shared by Pipeline and ThreadedPipeline. */
+struct PipelineBaseConfig
+{
+    /** Register file banking; rename allocates from per-bank lists. */
+    BankConfig banks;
+    /** Register cache in front of the register file; off by default. */
+    RegCacheConfig regCache;
+    /** Rename moves to their source's register instead of executing. */
+    bool moveElimination = false;
+};
+
+struct PipelineConfig : PipelineBaseConfig
+{
+    /** Instructions each stage handles per cycle. */
+    unsigned decodeWidth = 4;
+    unsigned renameWidth = 4;
+    unsigned dispatchWidth = 4;
+    /** Capacity of the decode->rename and rename->dispatch queues. */
+    size_t decodeQueueSize = 16;
+    size_t renameQueueSize = 16;
+    /** L1 model fed the lines of the capabilities read; off by default. */
+    L1CacheConfig l1;
+    /**
+     * Cycles from dispatch until the destination is written and its
+     * consumers may dispatch; 0 writes at dispatch.
+     */
+    unsigned writeLatency = 0;
+    /** Cycles after that write until the previous mapping is freed. */
+    unsigned freeLatency = 0;
+};
+
+/** Counts shared by Pipeline and ThreadedPipeline. */
+struct PipelineBaseStats
+{
+    uint64_t regReads = 0;
+    uint64_t regWrites = 0;
+    uint64_t moves = 0;
+    /** Moves eliminated at rename, with no read, write or allocation. */
+    uint64_t eliminatedMoves = 0;
+    /** Sum of all source values read, to compare runs cheaply. */
+    uint64_t readChecksum = 0;
+
+    void print(std::ostream &os) const;
+};
+
+struct PipelineStats : PipelineBaseStats
+{
+    uint64_t cycles = 0;
+    uint64_t decodedInsts = 0;
+    uint64_t renamedInsts = 0;
+    uint64_t dispatchedInsts = 0;
+
+    /** Cycles in which decode stopped because its queue was full. */
+    uint64_t decodeQueueFullCycles = 0;
+    /** Cycles in which rename stopped for want of a free register. */
+    uint64_t freeListEmptyCycles = 0;
+    /** Cycles in which rename stopped because its queue was full. */
+    uint64_t renameQueueFullCycles = 0;
+    /** Cycles in which rename had nothing to rename. */
+    uint64_t renameIdleCycles = 0;
+    /** Cycles in which dispatch stopped on a register file port. */
+    uint64_t portConflictCycles = 0;
+    /** Cycles in which dispatch waited for a source to be written. */
+    uint64_t scoreboardStallCycles = 0;
+    /** Delayed writes and frees completed. */
+    uint64_t events = 0;
+
+    /** Free registers and rename queue entries summed over cycles. */
+    uint64_t freeRegsSum = 0;
+    uint64_t renameQueueSum = 0;
+
+    double
+    ipc() const
+    {
+        return cycles ? double(dispatchedInsts) / cycles : 0.0;
+    }
+
+    double
+    avgFreeRegs() const
+    {
+        return cycles ? double(freeRegsSum) / cycles : 0.0;
+    }
+
+    double
+    avgRenameQueue() const
+    {
+        return cycles ? double(renameQueueSum) / cycles : 0.0;
+    }
+
+    void print(std::ostream &os) const;
+};
+
+/** A renamed instruction on its way to the register file. */
+struct RenamedInst
+{
+    PhysRegIdPtr dest;
+    /** Mapping to release at commit; null if dest kept it. */
+    PhysRegIdPtr prevDest;
+    uint8_t numSrcs;
+    /** Writes the value of srcs[0], not value. */
+    bool isMove;
+    /**
+     * An eliminated move; dest is shared and already written, so only
+     * prevDest goes back.
+     */
+    bool eliminated;
+    PhysRegIdPtr srcs[TraceRecord::MaxSrcRegs];
+    /** Writes of each source to wait for; Pipeline's scoreboard only. */
+    uint32_t srcWrites[TraceRecord::MaxSrcRegs];
+    RegVal value;
+};
+
+/**
+ * Cycle-driven decode -> rename -> dispatch model over a RenameContext.
+ *
+ * Stages are linked by fixed-capacity queues and evaluated back to front
+ * each cycle, so an instruction advances at most one stage per cycle and
+ * a stall propagates upstream as its queue fills. Rename stalls when the
+ * free list is empty or the dispatch queue is full; dispatch reads the
+ * sources, writes the destination register and retires the instruction,
+ * returning the previous mapping of its destination to the free list.
+ *
+ * With a banked register file, rename allocates from per-bank free lists
+ * and dispatch stops at the first instruction whose source reads or
+ * destination write find no free port in their bank this cycle.
+ *
+ * With a write or free latency, dispatch schedules the destination write
+ * and the release of the previous mapping on a timing wheel instead of
+ * doing them at once. Events due in a cycle complete before any stage
+ * runs, so rename sees the free list as of the current cycle, and a
+ * scoreboard holds consumers at dispatch until their sources are written.
+ *
+ * Writes to registers pinned by multi-write instructions are completed in
+ * the register file's PinnedWrites once per cycle, as a batch.
+ *
+ * With an L1 model, dispatch looks up the cache lines named by the
+ * capabilities an instruction reads, as one group.
+ *
+ * With move elimination, rename maps the destination of a move to its
+ * source's physical register. The move then needs no free register, and
+ * dispatch only retires it: no ports, reads or writes.
+ */
+class Pipeline
+{
+  private:
+    /** A register write or free completing in a later cycle. */
+    struct Event
+    {
+        enum Type : uint8_t { WriteReg, FreeReg };
+
+        Type type;
+        PhysRegIdPtr reg;
+        RegVal value;
+    };
+
+    PipelineConfig config;
+    RenameContext ctx;
+    /** Port accounting; only present with a banked register file. */
+    std::unique_ptr<RegFileBanks> banks;
+    /** Only present with an L1 model. */
+    std::unique_ptr<L1Cache> l1;
+
+    RingBuffer<TraceRecord> decodeQueue;
+    RingBuffer<RenamedInst> renameQueue;
+
+    /** Whether writes or frees go through the timing wheel. */
+    bool delayed = false;
+    TimingWheel<Event> events;
+    /**
+     * Writes renamed and writes done per physical register, by flat
+     * index. A source is ready once its register has done every write
+     * renamed before the reader; a reused pinned register can have
+     * several in flight.
+     */
+    std::vector<uint32_t> regWritesRenamed;
+    std::vector<uint32_t> regWritesDone;
+    /** Registers written this cycle while any register is pinned. */
+    std::vector<RegIndex> pinnedWrites;
+
+    const TraceRecord *traceNext = nullptr;
+    const TraceRecord *traceEnd = nullptr;
+
+    PipelineStats _stats;
+
+    void decode();
+    void rename();
+    void dispatch();
+    /** Put the write of value and the free of inst on the wheel. */
+    void scheduleCompletion(const RenamedInst &inst, RegVal value);
+    /** Carry out an event that has come due. */
+    void complete(const Event &event);
+
+    /** Write value to reg, noting the write if pinned writes are open. */
+    void
+    writeReg(PhysRegIdPtr reg, RegVal value)
+    {
+        ctx.regFile.setReg(reg, value);
+        if (ctx.regFile.getPinnedWrites().anyPinned())
+            pinnedWrites.push_back(reg->flatIndex());
+    }
+
+    bool
+    srcsReady(const RenamedInst &inst) const
+    {
+        bool ready = true;
+        for (unsigned s = 0; s < inst.numSrcs; s++) {
+            ready &= int32_t(regWritesDone[inst.srcs[s]->flatIndex()] -
+                             inst.srcWrites[s]) >= 0;
+        }
+        return ready;
+    }
+
+  public:
+    Pipeline(const RegClass &reg_class, unsigned num_phys_regs,
+             const PipelineConfig &config);
+
+    RenameContext &context() { return ctx; }
+
+    /**
+     * Start over from state with a new configuration, keeping the
+     * register file, rename map and free lists. The banking must match
+     * the one the pipeline was built with.
+     */
+    void reset(const PipelineConfig &config, const RenameState &state);
+
+    /** Per-bank port statistics, or nullptr if not banked. */
+    const RegFileBanks *regFileBanks() const { return banks.get(); }
+
+    /** The L1 model, or nullptr if there is none. */
+    const L1Cache *l1Cache() const { return l1.get(); }
+
+    /** Feed the records [first, last) to decode. */
+    void
+    setTrace(const TraceRecord *first, const TraceRecord *last)
+    {
+        traceNext = first;
+        traceEnd = last;
+    }
+
+    /**
+     * True once the trace is consumed, every queue has drained and every
+     * delayed write and free has completed.
+     */
+    bool
+    drained() const
+    {
+        return traceNext == traceEnd && decodeQueue.empty() &&
+            renameQueue.empty() && events.empty();
+    }
+
+    /** Simulate one cycle. */
+    void tick();
+
+    /** Tick until drained. */
+    void
+    run()
+    {
+        while (!drained())
+            tick();
+    }
+
+    const PipelineStats &stats() const { return _stats; }
+    void resetStats() { _stats = PipelineStats(); }
+};
+
+} // namespace workflow
+
+#endif // __PIPELINE_HH__
@@ -0,0 +1,197 @@
+#include "probe.hh"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace workflow
+{
+
+namespace
+{
+
+constexpr size_t NumProbes = size_t(ProbeId::NumProbes);
+
+const char *const probeNames[NumProbes] = {
+    "camFind",
+    "renameMapRename",
+    "renameMapLookup",
+    "freeListGetReg",
+    "regFileGetReg",
+    "regFileSetReg",
+};
+
+struct ProbeTable;
+
+/** Every thread's table, plus the sums of exited threads. */
+struct ProbeRegistry
+{
+    std::mutex lock;
+    std::vector<ProbeTable *> live;
+    ProbeHistogram retired[NumProbes];
+};
+
+ProbeRegistry &
+registry()
+{
+    static ProbeRegistry reg;
+    return reg;
+}
+
+/** The histograms of one thread, folded into the registry at exit. */
+struct ProbeTable
+{
+    ProbeHistogram hists[NumProbes];
+
+    ProbeTable()
+    {
+        ProbeRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        reg.live.push_back(this);
+    }
+
+    ~ProbeTable()
+    {
+        ProbeRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.lock);
+        for (size_t i = 0; i < NumProbes; i++)
+            reg.retired[i].merge(hists[i]);
+        reg.live.erase(std::find(reg.live.begin(), reg.live.end(), this));
+    }
+};
+
+thread_local ProbeTable threadTable;
+
+int
+openTaskClock()
+{
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_SOFTWARE;
+    attr.config = PERF_COUNT_SW_TASK_CLOCK;
+    attr.exclude_hv = 1;
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/** Close the calling thread's counter at thread exit. */
+struct TaskClockFd
+{
+    int fd = -1;
+
+    ~TaskClockFd()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+};
+
+thread_local TaskClockFd taskClock;
+
+} // anonymous namespace
+
+void
+ProbeHistogram::merge(const ProbeHistogram &other)
+{
+    count += other.count;
+    sum += other.sum;
+    min = std::min(min, other.min);
+    max = std::max(max, other.max);
+    for (unsigned b = 0; b < NumBuckets; b++)
+        buckets[b] += other.buckets[b];
+}
+
+bool
+setProbeClock(ProbeClock clock)
+{
+    if (clock == ProbeClock::PerfTaskClock) {
+        const int fd = openTaskClock();
+        if (fd < 0)
+            return false;
+        close(fd);
+    }
+    activeProbeClock = clock;
+    return true;
+}
+
+uint64_t
+perfTaskClock()
+{
+    if (taskClock.fd < 0)
+        taskClock.fd = openTaskClock();
+    uint64_t value = 0;
+    if (read(taskClock.fd, &value, sizeof(value)) != sizeof(value))
+        return 0;
+    return value;
+}
+
+uint64_t
+steadyClockNs()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void
+recordProbe(ProbeId id, uint64_t latency)
+{
+    threadTable.hists[size_t(id)].add(latency);
+}
+
+void
+collectProbes(ProbeHistogram (&hists)[size_t(ProbeId::NumProbes)])
+{
+    ProbeRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.lock);
+    for (size_t i = 0; i < NumProbes; i++) {
+        hists[i] = reg.retired[i];
+        for (const ProbeTable *table : reg.live)
+            hists[i].merge(table->hists[i]);
+    }
+}
+
+void
+printProbes(std::ostream &os)
+{
+    // The cost of a probe around nothing, included in every latency.
+    uint64_t overhead = UINT64_MAX;
+    for (unsigned i = 0; i < 1000; i++) {
+        const uint64_t start = probeNow();
+        overhead = std::min(overhead, probeNow() - start);
+    }
+
+    os << "probe.clock "
+       << (activeProbeClock == ProbeClock::TSC ? "tsc" : "task-clock-ns")
+       << '\n'
+       << "probe.overhead " << overhead << '\n';
+
+    ProbeHistogram hists[NumProbes];
+    collectProbes(hists);
+    for (size_t i = 0; i < NumProbes; i++) {
+        const ProbeHistogram &hist = hists[i];
+        if (hist.count == 0)
+            continue;
+        const char *name = probeNames[i];
+        os << "probe." << name << ".count " << hist.count << '\n'
+           << "probe." << name << ".total " << hist.sum << '\n'
+           << "probe." << name << ".mean " << double(hist.sum) / hist.count
+           << '\n'
+           << "probe." << name << ".min " << hist.min << '\n'
+           << "probe." << name << ".max " << hist.max << '\n';
+        for (unsigned b = 0; b < ProbeHistogram::NumBuckets; b++) {
+            if (hist.buckets[b] == 0)
+                continue;
+            os << "probe." << name << '[' << (uint64_t(1) << b) - 1 << '-'
+               << (uint64_t(1) << (b + 1)) - 2 << "] " << hist.buckets[b]
+               << '\n';
+        }
+    }
+}
+
+} // namespace workflow
@@ -0,0 +1,135 @@
+#ifndef __PROBE_HH__
+#define __PROBE_HH__
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * Host timing probes on the simulator's hot paths, compiled in with
+ * -DPROBES=1. When off, PROBE_SCOPE expands to nothing and the probed
+ * functions are unchanged.
+ */
+#ifndef PROBES
+#define PROBES 0
+#endif
+
+namespace workflow
+{
+
+enum class ProbeId : uint8_t
+{
+    CamFind,
+    RenameMapRename,
+    RenameMapLookup,
+    FreeListGetReg,
+    RegFileGetReg,
+    RegFileSetReg,
+    NumProbes
+};
+
+/** What a probe reading counts. */
+enum class ProbeClock : uint8_t
+{
+    /** Time stamp counter cycles; steady clock ns where there is none. */
+    TSC,
+    /**
+     * Task clock ns of the calling thread from a perf_event_open
+     * software counter. Excludes time the thread was descheduled, but
+     * each reading is a system call.
+     */
+    PerfTaskClock
+};
+
+/** The clock in use; read on every probe, so kept inline. */
+inline ProbeClock activeProbeClock = ProbeClock::TSC;
+
+/**
+ * Select the clock of every probe; call before any probe fires.
+ * @return false, leaving TSC selected, if perf events are unavailable.
+ */
+bool setProbeClock(ProbeClock clock);
+
+/** Latency histogram of one probe, in power-of-two buckets. */
+struct ProbeHistogram
+{
+    static constexpr unsigned NumBuckets = 40;
+
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    /** Bucket b counts latencies in [2^b - 1, 2^(b+1) - 1). */
+    uint64_t buckets[NumBuckets] = {};
+
+    void
+    add(uint64_t latency)
+    {
+        unsigned b = 63 - __builtin_clzll(latency + 1);
+        buckets[b < NumBuckets ? b : NumBuckets - 1]++;
+        count++;
+        sum += latency;
+        min = latency < min ? latency : min;
+        max = latency > max ? latency : max;
+    }
+
+    void merge(const ProbeHistogram &other);
+};
+
+/** Task clock of the calling thread, opening its counter if needed. */
+uint64_t perfTaskClock();
+uint64_t steadyClockNs();
+
+inline uint64_t
+probeNow()
+{
+    if (activeProbeClock == ProbeClock::PerfTaskClock)
+        return perfTaskClock();
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return steadyClockNs();
+#endif
+}
+
+/** Add a latency to probe id in the calling thread's histograms. */
+void recordProbe(ProbeId id, uint64_t latency);
+
+/**
+ * Histograms of every probe summed over all threads, live or exited.
+ * Call while no probe is firing.
+ */
+void collectProbes(ProbeHistogram (&hists)[size_t(ProbeId::NumProbes)]);
+
+/** Print the histograms of every probe that fired. */
+void printProbes(std::ostream &os);
+
+/** Times the enclosing scope under probe id. */
+class ScopedProbe
+{
+  private:
+    const ProbeId id;
+    const uint64_t start;
+
+  public:
+    explicit ScopedProbe(ProbeId _id) : id(_id), start(probeNow()) {}
+    ~ScopedProbe() { recordProbe(id, probeNow() - start); }
+
+    ScopedProbe(const ScopedProbe &) = delete;
+    ScopedProbe &operator=(const ScopedProbe &) = delete;
+};
+
+} // namespace workflow
+
+#if PROBES
+#define PROBE_SCOPE(id) \
+    ::workflow::ScopedProbe _probe_scope(::workflow::ProbeId::id)
+#else
+#define PROBE_SCOPE(id) do {} while (0)
+#endif
+
+#endif // __PROBE_HH__
@@ -0,0 +1,77 @@
+#include "reg_cache.hh"
+
+#include <cassert>
+
+namespace workflow
+{
+
+void
+RegCacheStats::print(std::ostream &os) const
+{
+    os << "regCache.readHits " << readHits << '\n'
+       << "regCache.readMisses " << readMisses << '\n'
+       << "regCache.writeHits " << writeHits << '\n'
+       << "regCache.writeMisses " << writeMisses << '\n'
+       << "regCache.writebacks " << writebacks << '\n'
+       << "regCache.hitRate " << hitRate() << '\n';
+}
+
+RegCache::RegCache(RegFile &_backing, const RegCacheConfig &config)
+    : backing(_backing),
+      numSets(config.entries / config.assoc), assoc(config.assoc),
+      tags(config.entries, InvalidTag), values(config.entries, 0),
+      dirty(config.entries, false),
+      replPolicy(makeReplacementPolicy(config.policy, numSets, assoc))
+{
+    assert(config.assoc > 0 && config.entries % config.assoc == 0);
+    assert(numSets > 0);
+}
+
+unsigned
+RegCache::allocate(unsigned set, size_t idx)
+{
+    const size_t base = size_t(set) * assoc;
+    unsigned way = assoc;
+    for (unsigned w = 0; w < assoc; w++) {
+        if (tags[base + w] == InvalidTag) {
+            way = w;
+            break;
+        }
+    }
+    if (way == assoc) {
+        way = replPolicy->getVictim(set);
+        if (dirty[base + way]) {
+            backing.reg(tags[base + way]) = values[base + way];
+            _stats.writebacks++;
+        }
+    }
+    tags[base + way] = idx;
+    dirty[base + way] = false;
+    replPolicy->reset(set, way);
+    return way;
+}
+
+void
+RegCache::flush()
+{
+    for (size_t i = 0; i < tags.size(); i++) {
+        if (tags[i] != InvalidTag && dirty[i]) {
+            backing.reg(tags[i]) = values[i];
+            dirty[i] = false;
+            _stats.writebacks++;
+        }
+    }
+}
+
+void
+RegCache::invalidate()
+{
+    for (size_t i = 0; i < tags.size(); i++) {
+        if (tags[i] != InvalidTag)
+            replPolicy->invalidate(i / assoc, i % assoc);
+        tags[i] = InvalidTag;
+        dirty[i] = false;
+    }
+}
+
+} // namespace workflow
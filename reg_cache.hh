@@ -0,0 +1,138 @@
+#ifndef __REG_CACHE_HH__
+#define __REG_CACHE_HH__
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "regfile.hh"
+#include "replacement_policies.hh"
+
+namespace workflow
+{
+
+struct RegCacheConfig
+{
+    /** Total entries; 0 disables the cache. */
+    unsigned entries = 0;
+    unsigned assoc = 4;
+    ReplacementPolicyType policy = ReplacementPolicyType::LRU;
+
+    bool enabled() const { return entries != 0; }
+};
+
+struct RegCacheStats
+{
+    uint64_t readHits = 0;
+    uint64_t readMisses = 0;
+    uint64_t writeHits = 0;
+    uint64_t writeMisses = 0;
+    /** Dirty entries written back to the register file. */
+    uint64_t writebacks = 0;
+
+    uint64_t hits() const { return readHits + writeHits; }
+    uint64_t misses() const { return readMisses + writeMisses; }
+
+    double
+    hitRate() const
+    {
+        const uint64_t accesses = hits() + misses();
+        return accesses ? double(hits()) / accesses : 0.0;
+    }
+
+    void print(std::ostream &os) const;
+};
+
+/**
+ * Small set-associative write-back cache of register values in front of
+ * a backing RegFile. Only a read miss reads the backing file and only the
+ * writeback of a dirty victim writes it; a write miss allocates without
+ * fetching since it overwrites the whole register.
+ *
+ * Entries are kept as parallel arrays (tags, values, dirty bits) indexed
+ * by set * assoc + way.
+ */
+class RegCache
+{
+  private:
+    static constexpr RegIndex InvalidTag = InvalidRegIndex;
+
+    RegFile &backing;
+    const unsigned numSets;
+    const unsigned assoc;
+
+    std::vector<RegIndex> tags;
+    std::vector<RegVal> values;
+    std::vector<bool> dirty;
+    std::unique_ptr<ReplacementPolicy> replPolicy;
+
+    RegCacheStats _stats;
+
+    unsigned setOf(size_t idx) const { return idx % numSets; }
+
+    /** Way holding idx in set, or assoc if absent. */
+    unsigned
+    findWay(unsigned set, size_t idx) const
+    {
+        const RegIndex *set_tags = &tags[size_t(set) * assoc];
+        for (unsigned way = 0; way < assoc; way++) {
+            if (set_tags[way] == idx)
+                return way;
+        }
+        return assoc;
+    }
+
+    /** Make room for idx in set and return the way to fill. */
+    unsigned allocate(unsigned set, size_t idx);
+
+  public:
+    RegCache(RegFile &backing, const RegCacheConfig &config);
+
+    RegVal
+    read(size_t idx)
+    {
+        const unsigned set = setOf(idx);
+        unsigned way = findWay(set, idx);
+        if (way != assoc) {
+            _stats.readHits++;
+            replPolicy->touch(set, way);
+        } else {
+            _stats.readMisses++;
+            way = allocate(set, idx);
+            // Const access: a fill must not look like a write to the
+            // snapshot machinery.
+            values[size_t(set) * assoc + way] =
+                static_cast<const RegFile &>(backing).reg(idx);
+        }
+        return values[size_t(set) * assoc + way];
+    }
+
+    void
+    write(size_t idx, RegVal val)
+    {
+        const unsigned set = setOf(idx);
+        unsigned way = findWay(set, idx);
+        if (way != assoc) {
+            _stats.writeHits++;
+            replPolicy->touch(set, way);
+        } else {
+            _stats.writeMisses++;
+            way = allocate(set, idx);
+        }
+        values[size_t(set) * assoc + way] = val;
+        dirty[size_t(set) * assoc + way] = true;
+    }
+
+    /** Write every dirty entry back, keeping the entries. */
+    void flush();
+
+    /** Drop every entry without writing anything back. */
+    void invalidate();
+
+    const RegCacheStats &stats() const { return _stats; }
+};
+
+} // namespace workflow
+
+#endif // __REG_CACHE_HH__
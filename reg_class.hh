@@ -2,8 +2,11 @@
 #define __CPU__REG_CLASS_HH__
 
 #include <cstddef>
+#include <cstdint>
 #include <iterator>
+#include <limits>
 #include <string>
+#include <type_traits>
 #include <cassert>
 
 #include "debug.hh"
@@ -24,9 +27,29 @@ enum RegClassType
 // "Standard" register class names. Using these is encouraged but optional.
 inline constexpr char CapRegClassName[] = "capability";
 
-using RegIndex = uint16_t;
+/**
+ * Width in bits of register indices, chosen at compile time with
+ * -DREG_INDEX_BITS=32. 16-bit indices keep RegId, PhysRegId and the
+ * index arrays small but cap register files at 65535 registers; 32-bit
+ * indices allow millions.
+ */
+#ifndef REG_INDEX_BITS
+#define REG_INDEX_BITS 16
+#endif
+
+static_assert(REG_INDEX_BITS == 16 || REG_INDEX_BITS == 32,
+              "REG_INDEX_BITS must be 16 or 32");
+
+using RegIndex = std::conditional_t<REG_INDEX_BITS == 32, uint32_t,
+                                    uint16_t>;
 using RegVal = uint64_t;
 
+/** Index of no register; real registers use indices below it. */
+inline constexpr RegIndex InvalidRegIndex =
+    std::numeric_limits<RegIndex>::max();
+/** Most registers a single register file can hold. */
+inline constexpr size_t MaxNumRegs = InvalidRegIndex;
+
 class RegClass;
 class RegClassIterator;
 class BaseISA;
@@ -82,7 +105,9 @@ class RegId
   protected:
     const RegClass *_regClass = nullptr;
     RegIndex regIdx;
-    int numPinnedWrites;
+    // 16 bits, so with 16-bit indices PhysRegId's flat index fits in the
+    // tail padding of RegId and both take 16 bytes.
+    uint16_t numPinnedWrites;
 
     friend struct std::hash<RegId>;
     friend class RegClassIterator;
@@ -147,7 +172,14 @@ class RegId
     inline RegId flatten(const BaseISA &isa) const;
 
     int getNumPinnedWrites() const { return numPinnedWrites; }
-    void setNumPinnedWrites(int num_writes) { numPinnedWrites = num_writes; }
+
+    void
+    setNumPinnedWrites(int num_writes)
+    {
+        assert(num_writes >= 0 &&
+               num_writes <= std::numeric_limits<uint16_t>::max());
+        numPinnedWrites = num_writes;
+    }
 
     friend inline std::ostream& operator<<(std::ostream& os, const RegId& rid);
 };
@@ -350,20 +382,18 @@ RegClass::operator[](RegIndex idx) const
 class PhysRegId : private RegId
 {
   private:
+    // Pinned-write counters live in PinnedWrites, by flat index.
     RegIndex flatIdx;
-    int numPinnedWritesToComplete;
-    bool pinned;
 
   public:
-    explicit PhysRegId() : RegId(invalidRegClass, -1), flatIdx(-1),
-                           numPinnedWritesToComplete(0)
+    explicit PhysRegId() : RegId(invalidRegClass, InvalidRegIndex),
+                           flatIdx(InvalidRegIndex)
     {}
 
     /** Scalar PhysRegId constructor. */
     explicit PhysRegId(const RegClass &reg_class, RegIndex _regIdx,
               RegIndex _flatIdx)
-        : RegId(reg_class, _regIdx), flatIdx(_flatIdx),
-          numPinnedWritesToComplete(0), pinned(false)
+        : RegId(reg_class, _regIdx), flatIdx(_flatIdx)
     {}
 
     /** Visible RegId methods */
@@ -406,41 +436,6 @@ class PhysRegId : private RegId
 
     /** Flat index accessor */
     const RegIndex& flatIndex() const { return flatIdx; }
-
-    int getNumPinnedWrites() const { return numPinnedWrites; }
-
-    void
-    setNumPinnedWrites(int numWrites)
-    {
-        // An instruction with a pinned destination reg can get
-        // squashed. The numPinnedWrites counter may be zero when
-        // the squash happens but we need to know if the dest reg
-        // was pinned originally in order to reset counters properly
-        // for a possible re-rename using the same physical reg (which
-        // may be required in case of a mem access order violation).
-        pinned = (numWrites != 0);
-        numPinnedWrites = numWrites;
-    }
-
-    void decrNumPinnedWrites() { --numPinnedWrites; }
-    void incrNumPinnedWrites() { ++numPinnedWrites; }
-
-    bool isPinned() const { return pinned; }
-
-    int
-    getNumPinnedWritesToComplete() const
-    {
-        return numPinnedWritesToComplete;
-    }
-
-    void
-    setNumPinnedWritesToComplete(int numWrites)
-    {
-        numPinnedWritesToComplete = numWrites;
-    }
-
-    void decrNumPinnedWritesToComplete() { --numPinnedWritesToComplete; }
-    void incrNumPinnedWritesToComplete() { ++numPinnedWritesToComplete; }
 };
 
 using PhysRegIdPtr = PhysRegId*;
@@ -7,25 +7,107 @@
 #include <cstring>
 #include <vector>
 
+#include "page_buffer.hh"
 #include "reg_class.hh"
 
 namespace workflow
 {
 
+/**
+ * Register storage with nested snapshots.
+ *
+ * A snapshot is copy-before-write at page granularity: taking one only
+ * opens an empty undo log, and the first write to each page afterwards
+ * saves that page's old contents into the log. Restoring copies the
+ * saved pages back, so both costs scale with the pages actually written
+ * and the live registers stay in one flat array.
+ *
+ * The array is a PageBuffer: large register files are demand-zero
+ * mappings that cost nothing until touched, and clear() discards their
+ * pages rather than writing zeros.
+ */
 class RegFile
 {
+  public:
+    static constexpr size_t PageShift = 12;
+    static constexpr size_t PageBytes = size_t(1) << PageShift;
+
+    /** Snapshot handle; handles are depths in the snapshot stack. */
+    using SnapshotId = size_t;
+
   private:
-    std::vector<uint8_t> data;
+    PageBuffer<uint8_t> data;
     const size_t _size;
     const size_t _regShift;
     const size_t _regBytes;
 
+    /** Old page contents saved since one snapshot was taken. */
+    struct UndoLog
+    {
+        uint64_t epoch;
+        std::vector<size_t> pages;
+        /** Saved contents, PageBytes per entry of pages. */
+        std::vector<uint8_t> contents;
+    };
+    std::vector<UndoLog> snapshots;
+
+    /** Epoch of the newest snapshot, 0 when there is none. */
+    uint64_t curEpoch = 0;
+    uint64_t lastEpoch = 0;
+    /** Epoch in which each page was last saved. */
+    PageBuffer<uint64_t> pageEpoch;
+
+    size_t numPages() const { return pageEpoch.size(); }
+
+    size_t
+    pageLength(size_t page) const
+    {
+        return std::min(PageBytes, data.size() - (page << PageShift));
+    }
+
+    void
+    savePage(size_t page)
+    {
+        UndoLog &log = snapshots.back();
+        log.pages.push_back(page);
+        const uint8_t *src = data.data() + (page << PageShift);
+        log.contents.insert(log.contents.end(), src, src + pageLength(page));
+        log.contents.resize(log.pages.size() << PageShift);
+        pageEpoch[page] = curEpoch;
+    }
+
+    /** Called before every write to the byte range [offset, +len). */
+    void
+    willWrite(size_t offset, size_t len)
+    {
+        if (curEpoch == 0)
+            return;
+        for (size_t page = offset >> PageShift;
+                page <= (offset + len - 1) >> PageShift; page++) {
+            if (pageEpoch[page] != curEpoch)
+                savePage(page);
+        }
+    }
+
+    void
+    applyLog(const UndoLog &log)
+    {
+        for (size_t i = 0; i < log.pages.size(); i++) {
+            const size_t page = log.pages[i];
+            std::memcpy(data.data() + (page << PageShift),
+                        log.contents.data() + (i << PageShift),
+                        pageLength(page));
+        }
+    }
+
   public:
     const RegClass &regClass;
 
     RegFile(const RegClass &info, const size_t new_size) :
         data(new_size << info.regShift()), _size(new_size),
         _regShift(info.regShift()), _regBytes(info.regBytes()),
+        pageEpoch(((new_size << info.regShift()) + PageBytes - 1) >>
+                  PageShift),
         regClass(info)
     {}
 
@@ -40,6 +122,7 @@ class RegFile
     reg(size_t idx)
     {
         assert(sizeof(Reg) == _regBytes && idx < _size);
+        willWrite(idx << _regShift, _regBytes);
         return *reinterpret_cast<Reg *>(data.data() + (idx << _regShift));
     }
     template <typename Reg=RegVal>
@@ -54,6 +137,7 @@ class RegFile
     void *
     ptr(size_t idx)
     {
+        willWrite(idx << _regShift, _regBytes);
         return data.data() + (idx << _regShift);
     }
 
@@ -75,7 +159,91 @@ class RegFile
         std::memcpy(ptr(idx), val, _regBytes);
     }
 
-    void clear() { std::fill(data.begin(), data.end(), 0); }
+    void
+    clear()
+    {
+        if (!data.empty())
+            willWrite(0, data.size());
+        data.zero();
+    }
+
+    /** Take a snapshot of the current contents. O(1). */
+    SnapshotId
+    snapshot()
+    {
+        curEpoch = ++lastEpoch;
+        snapshots.push_back({ curEpoch, {}, {} });
+        return snapshots.size() - 1;
+    }
+
+    /**
+     * Roll the contents back to snapshot id, discarding any newer
+     * snapshots. Snapshot id stays valid and can be restored again.
+     */
+    void
+    restore(SnapshotId id)
+    {
+        assert(id < snapshots.size());
+        // Newest first, so each page ends up as it was at snapshot id.
+        for (size_t i = snapshots.size(); i-- > id;)
+            applyLog(snapshots[i]);
+        snapshots.resize(id + 1);
+        UndoLog &log = snapshots.back();
+        log.pages.clear();
+        log.contents.clear();
+        // A fresh epoch makes every page unsaved again.
+        log.epoch = curEpoch = ++lastEpoch;
+    }
+
+    /**
+     * Drop snapshot id and all newer ones, keeping the current contents.
+     * Saved pages an older snapshot still needs are handed down to it.
+     */
+    void
+    release(SnapshotId id)
+    {
+        assert(id < snapshots.size());
+        if (id == 0) {
+            snapshots.clear();
+            curEpoch = 0;
+            return;
+        }
+
+        UndoLog &parent = snapshots[id - 1];
+        std::vector<bool> saved(numPages(), false);
+        for (size_t page : parent.pages)
+            saved[page] = true;
+        // Oldest first: the first copy of a page not yet saved by the
+        // parent is the page as it was when the parent was taken.
+        for (size_t i = id; i < snapshots.size(); i++) {
+            const UndoLog &log = snapshots[i];
+            for (size_t j = 0; j < log.pages.size(); j++) {
+                const size_t page = log.pages[j];
+                if (saved[page])
+                    continue;
+                saved[page] = true;
+                parent.pages.push_back(page);
+                const uint8_t *src =
+                    log.contents.data() + (j << PageShift);
+                parent.contents.insert(parent.contents.end(), src,
+                                       src + PageBytes);
+            }
+        }
+        snapshots.resize(id);
+
+        curEpoch = parent.epoch;
+        for (size_t page : parent.pages)
+            pageEpoch[page] = curEpoch;
+    }
+
+    size_t numSnapshots() const { return snapshots.size(); }
+
+    /** Pages copied into the undo log of snapshot id so far. */
+    size_t
+    snapshotPages(SnapshotId id) const
+    {
+        return snapshots[id].pages.size();
+    }
 };
 }
 
@@ -0,0 +1,134 @@
+#include "regfile_banked.hh"
+
+#include <cassert>
+
+namespace workflow
+{
+
+bool
+parseBankMapping(const std::string &name, BankMapping &mapping)
+{
+    if (name == "interleaved")
+        mapping = BankMapping::Interleaved;
+    else if (name == "partitioned")
+        mapping = BankMapping::Partitioned;
+    else
+        return false;
+    return true;
+}
+
+bool
+parseBankAllocPolicy(const std::string &name, BankAllocPolicy &alloc)
+{
+    if (name == "rr")
+        alloc = BankAllocPolicy::RoundRobin;
+    else if (name == "least")
+        alloc = BankAllocPolicy::LeastLoaded;
+    else
+        return false;
+    return true;
+}
+
+BankedFreeList::BankedFreeList(const BankConfig &config,
+                               unsigned num_phys_regs)
+    : bankMap(config, num_phys_regs), policy(config.alloc),
+      banks(config.numBanks), allocs(config.numBanks, 0)
+{
+    assert(config.numBanks > 0);
+}
+
+unsigned
+BankedFreeList::chooseBank()
+{
+    assert(numFree > 0);
+    const unsigned num_banks = banks.size();
+    unsigned bank = nextBank;
+    if (policy == BankAllocPolicy::RoundRobin) {
+        while (!banks[bank].hasFreeRegs())
+            bank = (bank + 1) % num_banks;
+        nextBank = (bank + 1) % num_banks;
+    } else {
+        // Ties rotate so that equally loaded banks share allocations.
+        for (unsigned i = 1; i < num_banks; i++) {
+            const unsigned b = (nextBank + i) % num_banks;
+            if (banks[b].numFreeRegs() > banks[bank].numFreeRegs())
+                bank = b;
+        }
+        nextBank = (bank + 1) % num_banks;
+    }
+    return bank;
+}
+
+void
+BankedFreeList::clear()
+{
+    for (SimpleFreeList &bank : banks)
+        bank = SimpleFreeList();
+    numFree = 0;
+    nextBank = 0;
+}
+
+RegFileBanks::RegFileBanks(const BankConfig &config, unsigned num_phys_regs)
+    : bankMap(config, num_phys_regs), readPorts(config.readPorts),
+      writePorts(config.writePorts), readsUsed(config.numBanks, 0),
+      writesUsed(config.numBanks, 0), _stats(config.numBanks)
+{}
+
+void
+RegFileBanks::newCycle()
+{
+    // Accesses booked beyond the ports of a bank hold them next cycle.
+    for (unsigned &used : readsUsed)
+        used = used > readPorts ? used - readPorts : 0;
+    for (unsigned &used : writesUsed)
+        used = used > writePorts ? used - writePorts : 0;
+}
+
+bool
+RegFileBanks::reserve(const PhysRegIdPtr *reads, unsigned num_reads,
+                      PhysRegIdPtr write)
+{
+    const unsigned wbank = bankMap.bankOf(write);
+
+    // Refuse if any bank touched has no port left this cycle.
+    bool ok = writesUsed[wbank] < writePorts;
+    for (unsigned i = 0; i < num_reads; i++)
+        ok = ok && readsUsed[bankMap.bankOf(reads[i])] < readPorts;
+    if (!ok) {
+        for (unsigned i = 0; i < num_reads; i++) {
+            const unsigned bank = bankMap.bankOf(reads[i]);
+            if (readsUsed[bank] >= readPorts)
+                _stats[bank].readConflicts++;
+        }
+        if (writesUsed[wbank] >= writePorts)
+            _stats[wbank].writeConflicts++;
+        return false;
+    }
+
+    // Otherwise book every access; those beyond the free ports of their
+    // bank conflict and complete in a later cycle.
+    for (unsigned i = 0; i < num_reads; i++) {
+        const unsigned bank = bankMap.bankOf(reads[i]);
+        if (++readsUsed[bank] > readPorts)
+            _stats[bank].readConflicts++;
+        _stats[bank].reads++;
+    }
+    _stats[wbank].writes++;
+    writesUsed[wbank]++;
+    return true;
+}
+
+void
+RegFileBanks::print(std::ostream &os) const
+{
+    for (size_t bank = 0; bank < _stats.size(); bank++) {
+        const BankStats &s = _stats[bank];
+        os << "bank" << bank << ".reads " << s.reads << '\n'
+           << "bank" << bank << ".writes " << s.writes << '\n'
+           << "bank" << bank << ".readConflicts " << s.readConflicts << '\n'
+           << "bank" << bank << ".writeConflicts " << s.writeConflicts
+           << '\n';
+    }
+}
+
+} // namespace workflow
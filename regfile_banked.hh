@@ -0,0 +1,193 @@
+#ifndef __REGFILE_BANKED_HH__
+#define __REGFILE_BANKED_HH__
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "free_list.hh"
+#include "reg_class.hh"
+
+namespace workflow
+{
+
+/** How flat register indices are spread over banks. */
+enum class BankMapping
+{
+    Interleaved,    ///< bank = flat % numBanks
+    Partitioned     ///< consecutive blocks of registers per bank
+};
+
+/** Which bank a rename allocates from. */
+enum class BankAllocPolicy
+{
+    RoundRobin,     ///< next non-empty bank after the last one used
+    LeastLoaded     ///< bank with the most free registers
+};
+
+struct BankConfig
+{
+    /** 1 means a single flat register file. */
+    unsigned numBanks = 1;
+    BankMapping mapping = BankMapping::Interleaved;
+    BankAllocPolicy alloc = BankAllocPolicy::RoundRobin;
+    /** Ports of each bank per cycle. */
+    unsigned readPorts = 2;
+    unsigned writePorts = 1;
+
+    bool banked() const { return numBanks > 1; }
+};
+
+bool parseBankMapping(const std::string &name, BankMapping &mapping);
+bool parseBankAllocPolicy(const std::string &name, BankAllocPolicy &alloc);
+
+/** Maps flat register indices to banks. */
+class BankMap
+{
+  private:
+    unsigned numBanks;
+    BankMapping mapping;
+    size_t regsPerBank;
+
+  public:
+    BankMap(const BankConfig &config, unsigned num_phys_regs)
+        : numBanks(config.numBanks), mapping(config.mapping),
+          regsPerBank((num_phys_regs + config.numBanks - 1) /
+                      config.numBanks)
+    {}
+
+    unsigned
+    bankOf(RegIndex flat) const
+    {
+        return mapping == BankMapping::Interleaved ?
+            flat % numBanks : flat / regsPerBank;
+    }
+
+    unsigned
+    bankOf(PhysRegIdPtr reg) const
+    {
+        return bankOf(reg->flatIndex());
+    }
+};
+
+/**
+ * Free list split into one SimpleFreeList per bank. Registers return to
+ * the list of their own bank; allocation picks a bank per the policy and
+ * only touches that bank's list.
+ */
+class BankedFreeList
+{
+  private:
+    BankMap bankMap;
+    BankAllocPolicy policy;
+    std::vector<SimpleFreeList> banks;
+    unsigned nextBank = 0;
+    unsigned numFree = 0;
+    std::vector<uint64_t> allocs;
+
+    unsigned chooseBank();
+
+  public:
+    BankedFreeList(const BankConfig &config, unsigned num_phys_regs);
+
+    const BankMap &map() const { return bankMap; }
+
+    void
+    addReg(PhysRegIdPtr reg)
+    {
+        banks[bankMap.bankOf(reg)].addReg(reg);
+        numFree++;
+    }
+
+    template<class InputIt>
+    void
+    addRegs(InputIt first, InputIt last)
+    {
+        for (; first != last; ++first)
+            addReg(&*first);
+    }
+
+    PhysRegIdPtr
+    getReg()
+    {
+        const unsigned bank = chooseBank();
+        allocs[bank]++;
+        numFree--;
+        return banks[bank].getReg();
+    }
+
+    /** Empty every bank. */
+    void clear();
+
+    unsigned numFreeRegs() const { return numFree; }
+    bool hasFreeRegs() const { return numFree != 0; }
+
+    unsigned numBanks() const { return banks.size(); }
+
+    unsigned
+    numFreeRegs(unsigned bank) const
+    {
+        return banks[bank].numFreeRegs();
+    }
+
+    /** Allocate from a specific, non-empty bank. */
+    PhysRegIdPtr
+    getReg(unsigned bank)
+    {
+        allocs[bank]++;
+        numFree--;
+        return banks[bank].getReg();
+    }
+
+    /** Registers allocated from each bank. */
+    const std::vector<uint64_t> &allocations() const { return allocs; }
+};
+
+/**
+ * Per-cycle read/write port accounting of a banked register file.
+ */
+class RegFileBanks
+{
+  public:
+    struct BankStats
+    {
+        uint64_t reads = 0;
+        uint64_t writes = 0;
+        /** Accesses refused for lack of a free port. */
+        uint64_t readConflicts = 0;
+        uint64_t writeConflicts = 0;
+    };
+
+  private:
+    BankMap bankMap;
+    const unsigned readPorts;
+    const unsigned writePorts;
+    std::vector<unsigned> readsUsed;
+    std::vector<unsigned> writesUsed;
+    std::vector<BankStats> _stats;
+
+  public:
+    RegFileBanks(const BankConfig &config, unsigned num_phys_regs);
+
+    /** Start a new cycle, freeing the ports of finished accesses. */
+    void newCycle();
+
+    /**
+     * Book the ports of one instruction reading reads[0..num_reads) and
+     * writing write. The instruction is refused if a bank it touches has
+     * no free port this cycle; otherwise all of its accesses are booked,
+     * and those exceeding a bank's ports occupy them in the next cycle.
+     * Every access that finds no port counts as a conflict.
+     * @return true if the ports were booked.
+     */
+    bool reserve(const PhysRegIdPtr *reads, unsigned num_reads,
+                 PhysRegIdPtr write);
+
+    const std::vector<BankStats> &stats() const { return _stats; }
+    void print(std::ostream &os) const;
+};
+
+} // namespace workflow
+
+#endif // __REGFILE_BANKED_HH__
@@ -3,13 +3,27 @@
 namespace workflow
 {
 
+void
+CapCheckStats::print(std::ostream &os) const
+{
+    os << "capReads " << reads << '\n'
+       << "capWrites " << writes << '\n'
+       << "capReadFaults " << readFaults << '\n'
+       << "capWriteFaults " << writeFaults << '\n';
+}
+
 PhysRegFile::PhysRegFile(unsigned _numCapIntRegs,
 		const RegClass &reg_class)
-	: capRegFile(reg_class, _numCapIntRegs)
+	: capRegFile(reg_class, _numCapIntRegs), pinnedWrites(_numCapIntRegs)
 {
+    if (_numCapIntRegs > MaxNumRegs)
+        panic("%u physical registers need wider indices "
+              "(REG_INDEX_BITS=32)\n", _numCapIntRegs);
+
     RegIndex phys_reg;
     RegIndex flat_reg_idx = 0;
 
+    capRegIds.reserve(_numCapIntRegs);
     // The initial batch of registers are the capability ones
     for (phys_reg = 0; phys_reg < _numCapIntRegs; phys_reg++) {
         capRegIds.emplace_back(reg_class,
@@ -17,6 +31,17 @@ PhysRegFile::PhysRegFile(unsigned _numCapIntRegs,
     }
 }
 
+void
+PhysRegFile::setRegCache(const RegCacheConfig &config)
+{
+    if (regCache)
+        regCache->flush();
+    if (config.enabled())
+        regCache.reset(new RegCache(capRegFile, config));
+    else
+        regCache.reset();
+}
+
 PhysRegFile::IdRange
 PhysRegFile::getCapRegIds()
 {
@@ -1,16 +1,32 @@
 #ifndef __REGFILE_O3_HH__
 #define __REGFILE_O3_HH__
 
+#include <cassert>
 #include <cstring>
+#include <memory>
+#include <ostream>
 #include <vector>
 
+#include "capability.hh"
+#include "debug.hh"
+#include "pinned_writes.hh"
+#include "probe.hh"
+#include "reg_cache.hh"
 #include "regfile.hh"
 
-#define panic(arg...) \
-  do { printf("Panic: " arg); exit(1); } while (0)
-
 namespace workflow
 {
+
+struct CapCheckStats
+{
+    uint64_t reads = 0;
+    uint64_t writes = 0;
+    uint64_t readFaults = 0;
+    uint64_t writeFaults = 0;
+
+    void print(std::ostream &os) const;
+};
+
 /**
  * Simple capability physical register file class.
  */
@@ -27,6 +43,26 @@ class PhysRegFile
     RegFile capRegFile;
     std::vector<PhysRegId> capRegIds;
 
+    /** Optional register cache in front of capRegFile; null if off. */
+    std::unique_ptr<RegCache> regCache;
+
+    /** Pinned-write counters of capRegIds, by flat index. */
+    PinnedWrites pinnedWrites;
+
+    /** Checked-access mode; see setCheckedAccess(). */
+    bool checkAccess = false;
+    CapAccessMask readMask = {};
+    CapAccessMask writeMask = {};
+    mutable CapCheckStats _capStats;
+
+    RegVal
+    readReg(RegIndex idx) const
+    {
+        if (regCache)
+            return regCache->read(idx);
+        return capRegFile.reg(idx);
+    }
+
    /**
      * Number of physical general purpose registers
      */
@@ -48,13 +84,18 @@ class PhysRegFile
     RegVal
     getReg(PhysRegIdPtr phys_reg) const
     {
+        PROBE_SCOPE(RegFileGetReg);
         const RegClassType type = phys_reg->classValue();
         if (type != CapRegClass)
             panic("Only capability registers are supported!");
         const RegIndex idx = phys_reg->index();
 
-        return capRegFile.reg(idx);
- 
+        const RegVal val = readReg(idx);
+        if (checkAccess) {
+            _capStats.reads++;
+            _capStats.readFaults += capFault(val, readMask);
+        }
+        return val;
     }
 
     void
@@ -69,11 +110,19 @@ class PhysRegFile
     void
     setReg(PhysRegIdPtr phys_reg, RegVal val)
     {
+        PROBE_SCOPE(RegFileSetReg);
         const RegClassType type = phys_reg->classValue();
         if (type != CapRegClass)
             panic("Only capability registers are supported!");
         const RegIndex idx = phys_reg->index();
-        capRegFile.reg(idx) = val;
+        if (checkAccess) {
+            _capStats.writes++;
+            _capStats.writeFaults += capFault(val, writeMask);
+        }
+        if (regCache)
+            regCache->write(idx, val);
+        else
+            capRegFile.reg(idx) = val;
     }
 
     void
@@ -89,6 +138,91 @@ class PhysRegFile
 
     /* only one class of registers */
     IdRange getCapRegIds();
+
+    /**
+     * Check every value read against read_mask and every value written
+     * against write_mask, counting the faults. Faulting accesses still
+     * complete; the counts measure what enforcement would reject.
+     */
+    void
+    setCheckedAccess(const CapAccessMask &read_mask,
+                     const CapAccessMask &write_mask)
+    {
+        checkAccess = true;
+        readMask = read_mask;
+        writeMask = write_mask;
+    }
+
+    void clearCheckedAccess() { checkAccess = false; }
+    bool checkedAccess() const { return checkAccess; }
+    const CapCheckStats &capCheckStats() const { return _capStats; }
+    void resetCapCheckStats() { _capStats = CapCheckStats(); }
+
+    /**
+     * Check the values of up to 64 registers against mask at once. Reads
+     * the backing file directly, leaving the register cache and the check
+     * counts alone; flushRegCache() first if the cache may hold newer
+     * values.
+     * @return A mask with bit i set if regs[i] faults.
+     */
+    uint64_t
+    checkRegs(const PhysRegIdPtr *regs, unsigned num_regs,
+              const CapAccessMask &mask) const
+    {
+        assert(num_regs <= 64);
+        uint64_t faults = 0;
+        for (unsigned i = 0; i < num_regs; i++) {
+            const RegVal val = capRegFile.reg(regs[i]->index());
+            faults |= uint64_t(capFault(val, mask)) << i;
+        }
+        return faults;
+    }
+
+    /**
+     * Put a register cache in front of the register file, replacing any
+     * previous one after writing it back. A config with no entries turns
+     * the cache off.
+     */
+    void setRegCache(const RegCacheConfig &config);
+
+    /** The register cache, or null if there is none. */
+    const RegCache *getRegCache() const { return regCache.get(); }
+
+    /** Write dirty register cache entries back to the register file. */
+    void
+    flushRegCache()
+    {
+        if (regCache)
+            regCache->flush();
+    }
+
+    PinnedWrites &getPinnedWrites() { return pinnedWrites; }
+    const PinnedWrites &getPinnedWrites() const { return pinnedWrites; }
+
+    /**
+     * Copy-on-write snapshots of the register values; see RegFile. The
+     * register cache is written back before a snapshot and dropped on a
+     * restore, so snapshots only ever see the backing file.
+     */
+    /** @{ */
+    RegFile::SnapshotId
+    snapshot()
+    {
+        flushRegCache();
+        return capRegFile.snapshot();
+    }
+
+    void
+    restore(RegFile::SnapshotId id)
+    {
+        if (regCache)
+            regCache->invalidate();
+        capRegFile.restore(id);
+    }
+
+    void release(RegFile::SnapshotId id) { capRegFile.release(id); }
+    size_t numSnapshots() const { return capRegFile.numSnapshots(); }
+    /** @} */
 };
 
 }
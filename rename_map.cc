@@ -1,22 +1,58 @@
 #include "rename_map.hh"
 
+#include "debug.hh"
+
 namespace workflow {
 
-RenameMap::RenameMap() : freeList(NULL)
+RenameMap::RenameMap() : freeList(NULL), bankedFreeList(NULL)
 {
 }
 
 void RenameMap::init(const RegClass &reg_class, SimpleFreeList *_freeList) {
-    assert(freeList == NULL);
+    assert(freeList == NULL && bankedFreeList == NULL);
     assert(map.empty());
 
-    map.resize(reg_class.numRegs());
+    map.reset(reg_class.numRegs());
     freeList = _freeList;
 }
 
+void RenameMap::init(const RegClass &reg_class, BankedFreeList *_freeList) {
+    assert(freeList == NULL && bankedFreeList == NULL);
+    assert(map.empty());
+
+    map.reset(reg_class.numRegs());
+    bankedFreeList = _freeList;
+}
+
+void
+RenameMap::initIdentity(const RegClass &reg_class, SimpleFreeList *_freeList,
+                        PhysRegId *phys_regs, size_t num_phys_regs,
+                        size_t num_mapped)
+{
+    if (num_mapped > reg_class.numRegs() || num_mapped > num_phys_regs)
+        panic("Cannot map %zu of %zu architectural registers to %zu "
+              "physical registers\n", num_mapped,
+              reg_class.numRegs(), num_phys_regs);
+    initIdentity(reg_class, _freeList, phys_regs, num_mapped);
+    freeList->addRegs(phys_regs + num_mapped, phys_regs + num_phys_regs);
+}
+
+void
+RenameMap::initIdentity(const RegClass &reg_class, SimpleFreeList *_freeList,
+                        PhysRegId *phys_regs, size_t num_mapped)
+{
+    if (num_mapped > reg_class.numRegs())
+        panic("Cannot map %zu of %zu architectural registers\n",
+              num_mapped, reg_class.numRegs());
+    init(reg_class, _freeList);
+    for (size_t i = 0; i < num_mapped; i++)
+        map[i] = &phys_regs[i];
+}
+
 RenameMap::RenameInfo
 RenameMap::rename(const RegId& arch_reg)
 {
+    PROBE_SCOPE(RenameMapRename);
     PhysRegIdPtr renamed_reg;
     // Record the current physical register that is renamed to the
     // requested architected register.
@@ -25,20 +61,43 @@ RenameMap::rename(const RegId& arch_reg)
     if (arch_reg.is(InvalidRegClass)) {
         assert(prev_reg->is(InvalidRegClass));
         renamed_reg = prev_reg;
-    } else if (prev_reg->getNumPinnedWrites() > 0) {
+    } else if (pinnedWrites &&
+               pinnedWrites->mustReuse(prev_reg->flatIndex())) {
         // Do not rename if the register is pinned
-        assert(arch_reg.getNumPinnedWrites() == 0);  // Prevent pinning the
-                                                     // same register twice
+        if (arch_reg.getNumPinnedWrites() != 0)
+            panic("Cannot pin %s %u again while it is pinned\n",
+                  arch_reg.className(), unsigned(arch_reg.index()));
         renamed_reg = prev_reg;
-        renamed_reg->decrNumPinnedWrites();
+        pinnedWrites->reuse(prev_reg->flatIndex());
     } else {
-        renamed_reg = freeList->getReg();
+        renamed_reg = allocReg();
         map[arch_reg.index()] = renamed_reg;
-        renamed_reg->setNumPinnedWrites(arch_reg.getNumPinnedWrites());
+        if (arch_reg.getNumPinnedWrites() > 0) {
+            if (!pinnedWrites)
+                panic("Pinned writes need RenameMap::setPinnedWrites\n");
+            pinnedWrites->pin(renamed_reg->flatIndex(),
+                              arch_reg.getNumPinnedWrites());
+        }
     }
-    std::cout << "Renamed reg " << arch_reg << " to physical reg " << renamed_reg->flatIndex()  << 
-	    " old mapping was " << prev_reg->flatIndex() << std::endl;
+    if (arch_reg.regClass().debug())
+        std::cout << "Renamed reg " << arch_reg << " to physical reg "
+                  << renamed_reg->flatIndex() << " old mapping was "
+                  << prev_reg->flatIndex() << std::endl;
     return RenameInfo(renamed_reg, prev_reg);
 }
 
+RenameMap::RenameInfo
+RenameMap::renameMove(const RegId& arch_reg, const RegId& src_reg)
+{
+    PhysRegIdPtr prev_reg = map[arch_reg.index()];
+    PhysRegIdPtr shared_reg = map[src_reg.index()];
+    map[arch_reg.index()] = shared_reg;
+    if (arch_reg.regClass().debug())
+        std::cout << "Renamed reg " << arch_reg << " to physical reg "
+                  << shared_reg->flatIndex() << " of " << src_reg
+                  << " old mapping was " << prev_reg->flatIndex()
+                  << std::endl;
+    return RenameInfo(shared_reg, prev_reg);
+}
+
 }
@@ -3,8 +3,12 @@
 
 #include <vector>
 
+#include "page_buffer.hh"
+#include "pinned_writes.hh"
+#include "probe.hh"
 #include "reg_class.hh"
 #include "free_list.hh"
+#include "regfile_banked.hh"
 
 namespace workflow
 {
@@ -12,7 +16,8 @@ namespace workflow
 class RenameMap
 {
   private:
-    using Arch2PhysMap = std::vector<PhysRegIdPtr>;
+    /** Lazily zeroed, so huge architectural register counts are cheap. */
+    using Arch2PhysMap = PageBuffer<PhysRegIdPtr>;
     Arch2PhysMap map;
 
   public:
@@ -24,11 +29,53 @@ class RenameMap
      * registers will be allocated in rename()
      */
     SimpleFreeList *freeList;
+    /* Used instead of freeList when the register file is banked. */
+    BankedFreeList *bankedFreeList;
+    /* Pinned-write state of the physical registers; null if none. */
+    PinnedWrites *pinnedWrites = nullptr;
+
+    PhysRegIdPtr
+    allocReg()
+    {
+        return bankedFreeList ? bankedFreeList->getReg() :
+            freeList->getReg();
+    }
 
   public:
     RenameMap(); // default constructor
 
     void init(const RegClass& reg_class, SimpleFreeList *_freeList);
+    void init(const RegClass& reg_class, BankedFreeList *_freeList);
+
+    /**
+     * init() with architectural register i mapped to phys_regs[i] for
+     * every i < num_mapped, and the other num_phys_regs - num_mapped
+     * registers of phys_regs put on the free list in order. The
+     * remaining architectural registers are left unmapped. Builds the
+     * table and the free list in one pass each, in place of a setEntry()
+     * per register.
+     */
+    void initIdentity(const RegClass& reg_class, SimpleFreeList *_freeList,
+                      PhysRegId *phys_regs, size_t num_phys_regs,
+                      size_t num_mapped);
+
+    /**
+     * initIdentity() for a free list that already holds the unmapped
+     * registers, e.g. one built with the SimpleFreeList range
+     * constructor; only the first num_mapped registers are mapped.
+     */
+    void initIdentity(const RegClass& reg_class, SimpleFreeList *_freeList,
+                      PhysRegId *phys_regs, size_t num_mapped);
+
+    /**
+     * Track pinned writes in pinned_writes, normally the one of the
+     * register file renamed into. Without it no register can be pinned.
+     */
+    void
+    setPinnedWrites(PinnedWrites *pinned_writes)
+    {
+        pinnedWrites = pinned_writes;
+    }
 
     typedef std::pair<PhysRegIdPtr, PhysRegIdPtr> RenameInfo;
     /**
@@ -40,6 +87,17 @@ class RenameMap
      */
     RenameInfo rename(const RegId& arch_reg);
 
+    /**
+     * Eliminate a move: map arch_reg to the physical register src_reg is
+     * mapped to, without allocating one. The caller keeps count of the
+     * mappings sharing it.
+     * @param arch_reg The destination of the move.
+     * @param src_reg The source of the move.
+     * @return A RenameInfo pair of the shared and the previous physical
+     * registers.
+     */
+    RenameInfo renameMove(const RegId& arch_reg, const RegId& src_reg);
+
     /**
      * Look up the physical register mapped to an architectural register.
      * @param arch_reg The architectural register to look up.
@@ -48,6 +106,7 @@ class RenameMap
     PhysRegIdPtr
     lookup(const RegId& arch_reg) const
     {
+        PROBE_SCOPE(RenameMapLookup);
         assert(arch_reg.index() <= map.size());
         return map[arch_reg.index()];
     }
@@ -66,7 +125,12 @@ class RenameMap
     }
 
     /** Return the number of free entries on the associated free list. */
-    unsigned numFreeEntries() const { return freeList->numFreeRegs(); }
+    unsigned
+    numFreeEntries() const
+    {
+        return bankedFreeList ? bankedFreeList->numFreeRegs() :
+            freeList->numFreeRegs();
+    }
 
     size_t numArchRegs() const { return map.size(); }
 
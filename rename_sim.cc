@@ -0,0 +1,294 @@
+#include "rename_sim.hh"
+
+#include <algorithm>
+#include <cassert>
+
+#include "static_rename_map.hh"
+
+namespace workflow
+{
+
+RenameState
+RenameState::initial(unsigned num_arch_regs, unsigned num_phys_regs)
+{
+    assert(num_arch_regs < num_phys_regs);
+    RenameState state;
+    state.archToPhys.resize(num_arch_regs);
+    for (unsigned i = 0; i < num_arch_regs; i++)
+        state.archToPhys[i] = i;
+    state.freeRegs.reserve(num_phys_regs - num_arch_regs);
+    for (unsigned i = num_arch_regs; i < num_phys_regs; i++)
+        state.freeRegs.push_back(i);
+    state.regValues.assign(num_phys_regs, 0);
+    state.pinnedRenames.assign(num_arch_regs, 0);
+    return state;
+}
+
+void
+SimStats::merge(const SimStats &other)
+{
+    numInsts += other.numInsts;
+    numSrcReads += other.numSrcReads;
+    numRegWrites += other.numRegWrites;
+    numMoves += other.numMoves;
+    numEliminatedMoves += other.numEliminatedMoves;
+    readChecksum += other.readChecksum;
+    minFreeRegs = std::min(minFreeRegs, other.minFreeRegs);
+}
+
+void
+SimStats::print(std::ostream &os) const
+{
+    os << "insts " << numInsts << '\n'
+       << "srcReads " << numSrcReads << '\n'
+       << "regWrites " << numRegWrites << '\n'
+       << "moves " << numMoves << '\n'
+       << "eliminatedMoves " << numEliminatedMoves << '\n'
+       << "readChecksum 0x" << std::hex << readChecksum << std::dec << '\n'
+       << "minFreeRegs " << minFreeRegs << '\n';
+}
+
+RenameContext::RenameContext(const RegClass &reg_class,
+                             unsigned num_phys_regs,
+                             const BankConfig &banks)
+    : regClass(reg_class), regFile(num_phys_regs, reg_class)
+{
+    PhysRegFile::IdRange ids = regFile.getCapRegIds();
+    physRegs.reserve(num_phys_regs);
+    for (auto it = ids.first; it != ids.second; ++it)
+        physRegs.push_back(&*it);
+    renameMap.setPinnedWrites(&regFile.getPinnedWrites());
+    if (banks.banked()) {
+        bankedFreeList =
+            std::make_unique<BankedFreeList>(banks, num_phys_regs);
+        renameMap.init(reg_class, bankedFreeList.get());
+        loadState(RenameState::initial(reg_class.numRegs(), num_phys_regs));
+    } else {
+        // RenameState::initial() without building it; a new register
+        // file already holds zeros.
+        assert(reg_class.numRegs() < num_phys_regs);
+        renameMap.initIdentity(reg_class, &freeList, &*ids.first,
+                               num_phys_regs, reg_class.numRegs());
+    }
+}
+
+void
+RenameContext::loadState(const RenameState &state)
+{
+    assert(state.archToPhys.size() == renameMap.numArchRegs());
+    assert(state.regValues.size() == physRegs.size());
+
+    regFile.getPinnedWrites().clear();
+    if (bankedFreeList) {
+        bankedFreeList->clear();
+        for (RegIndex flat : state.freeRegs)
+            bankedFreeList->addReg(physRegs[flat]);
+    } else {
+        freeList.assign(state.freeRegs.begin(), state.freeRegs.end(),
+                        [this](RegIndex flat) { return physRegs[flat]; });
+    }
+    for (size_t arch = 0; arch < state.archToPhys.size(); arch++)
+        renameMap.setEntry(archReg(arch), physRegs[state.archToPhys[arch]]);
+    assert(state.pinnedRenames.size() == state.archToPhys.size());
+    for (size_t arch = 0; arch < state.pinnedRenames.size(); arch++) {
+        if (const unsigned renames = state.pinnedRenames[arch])
+            regFile.getPinnedWrites().setPinned(state.archToPhys[arch],
+                                                renames, renames);
+    }
+    for (size_t flat = 0; flat < physRegs.size(); flat++)
+        regFile.setReg(physRegs[flat], state.regValues[flat]);
+    if (moveElimination())
+        countMappings();
+}
+
+void
+RenameContext::setMoveElimination(bool enable)
+{
+    if (!enable) {
+        refCounts.clear();
+        refCounts.shrink_to_fit();
+        return;
+    }
+    countMappings();
+}
+
+void
+RenameContext::countMappings()
+{
+    refCounts.assign(physRegs.size(), 0);
+    for (PhysRegIdPtr phys : renameMap)
+        refCounts[phys->flatIndex()]++;
+}
+
+RenameMap::RenameInfo
+RenameContext::renameCounted(const TraceRecord &rec)
+{
+    if (!rec.isMove) {
+        RenameMap::RenameInfo info = renameMap.rename(destReg(rec));
+        // A reused pinned register keeps its mappings.
+        if (freesPrev(info))
+            refCounts[info.first->flatIndex()] = 1;
+        return info;
+    }
+    const PinnedWrites &pinned = regFile.getPinnedWrites();
+    const RegId dest = archReg(rec.dest);
+    const RegId src = archReg(rec.srcs[0]);
+    if (pinned.mustReuse(renameMap.lookup(dest)->flatIndex()) ||
+        pinned.mustReuse(renameMap.lookup(src)->flatIndex()))
+        panic("Cannot eliminate a move of pinned register %u or %u\n",
+              unsigned(rec.dest), unsigned(rec.srcs[0]));
+    RenameMap::RenameInfo info = renameMap.renameMove(dest, src);
+    if (!freesPrev(info))
+        return info;
+    uint16_t &count = refCounts[info.first->flatIndex()];
+    if (count == UINT16_MAX)
+        panic("Physical register %u shared by too many mappings\n",
+              unsigned(info.first->flatIndex()));
+    count++;
+    return info;
+}
+
+void
+RenameContext::saveState(RenameState &state) const
+{
+    state.archToPhys.clear();
+    for (PhysRegIdPtr phys : renameMap)
+        state.archToPhys.push_back(phys->flatIndex());
+
+    state.freeRegs.clear();
+    if (bankedFreeList) {
+        // Bank by bank; the interleaving across banks is not kept.
+        BankedFreeList free_list = *bankedFreeList;
+        for (unsigned bank = 0; bank < free_list.numBanks(); bank++) {
+            while (free_list.numFreeRegs(bank))
+                state.freeRegs.push_back(
+                        free_list.getReg(bank)->flatIndex());
+        }
+    } else {
+        SimpleFreeList free_list = freeList;
+        while (free_list.hasFreeRegs())
+            state.freeRegs.push_back(free_list.getReg()->flatIndex());
+    }
+
+    state.regValues.resize(physRegs.size());
+    for (size_t flat = 0; flat < physRegs.size(); flat++)
+        state.regValues[flat] = regFile.getReg(physRegs[flat]);
+
+    const PinnedWrites &pinned = regFile.getPinnedWrites();
+    state.pinnedRenames.clear();
+    for (PhysRegIdPtr phys : renameMap)
+        state.pinnedRenames.push_back(
+                pinned.numRenamesLeft(phys->flatIndex()));
+}
+
+void
+RenameSim::execute(const TraceRecord &rec)
+{
+    _stats.numMoves += rec.isMove;
+    if (ctx.eliminates(rec)) {
+        // Renaming is all there is to an eliminated move.
+        RenameMap::RenameInfo info = ctx.renameDest(rec);
+        if (ctx.freesPrev(info))
+            ctx.releaseReg(info.second);
+        _stats.numEliminatedMoves++;
+        _stats.numInsts++;
+        return;
+    }
+
+    RegVal value = rec.value;
+    for (unsigned i = 0; i < rec.numSrcs; i++) {
+        PhysRegIdPtr src =
+            ctx.renameMap.lookup(ctx.archReg(rec.srcs[i]));
+        value = ctx.regFile.getReg(src);
+        _stats.readChecksum += value;
+    }
+    _stats.numSrcReads += rec.numSrcs;
+    // A move writes what it read from its only source.
+    if (!rec.isMove)
+        value = rec.value;
+
+    RenameMap::RenameInfo info = ctx.renameDest(rec);
+    _stats.minFreeRegs = std::min(_stats.minFreeRegs, ctx.numFreeRegs());
+    ctx.regFile.setReg(info.first, value);
+    _stats.numRegWrites++;
+    PinnedWrites &pinned = ctx.regFile.getPinnedWrites();
+    if (pinned.anyPinned())
+        pinned.completeWrites(&info.first->flatIndex(), 1);
+
+    // Commit: the previous mapping of dest is dead.
+    if (ctx.freesPrev(info))
+        ctx.releaseReg(info.second);
+    _stats.numInsts++;
+}
+
+namespace
+{
+
+/** fastForward() over an architectural-to-physical table of any kind. */
+template <class Table>
+void
+fastForwardIn(Table &arch_to_phys, RenameState &state,
+              const TraceRecord *first, const TraceRecord *last)
+{
+    std::vector<RegIndex> &ring = state.freeRegs;
+    const size_t num_free = ring.size();
+    assert(num_free > 0);
+
+    // The free list holds a constant number of registers: each step pops
+    // the head and pushes the old mapping, which lands in the slot just
+    // vacated once the head moves past it.
+    size_t head = 0;
+    for (; first != last; ++first) {
+        const RegVal value = first->isMove ?
+            state.regValues[arch_to_phys[first->srcs[0]]] : first->value;
+        RegIndex &mapping = arch_to_phys[first->dest];
+        uint16_t &pinned = state.pinnedRenames[first->dest];
+        if (pinned) {
+            // Reuse the pinned register; nothing is allocated.
+            pinned--;
+            state.regValues[mapping] = value;
+            continue;
+        }
+        const RegIndex renamed = ring[head];
+        ring[head] = mapping;
+        mapping = renamed;
+        pinned = first->numPinnedWrites;
+        state.regValues[renamed] = value;
+        if (++head == num_free)
+            head = 0;
+    }
+    std::rotate(ring.begin(), ring.begin() + head, ring.end());
+}
+
+/** Fixed-ISA version: the table is a StaticRenameMap on the stack. */
+template <size_t NumArchRegs>
+void
+fastForwardFixed(RenameState &state, const TraceRecord *first,
+                 const TraceRecord *last)
+{
+    StaticRenameMap<NumArchRegs, RegIndex> map;
+    map.load(state.archToPhys.data());
+    fastForwardIn(map, state, first, last);
+    map.store(state.archToPhys.data());
+}
+
+} // anonymous namespace
+
+void
+fastForward(RenameState &state, const TraceRecord *first,
+            const TraceRecord *last)
+{
+    switch (state.archToPhys.size()) {
+      case 32:
+        fastForwardFixed<32>(state, first, last);
+        break;
+      case 64:
+        fastForwardFixed<64>(state, first, last);
+        break;
+      default:
+        fastForwardIn(state.archToPhys, state, first, last);
+        break;
+    }
+}
+
+} // namespace workflow
@@ -0,0 +1,241 @@
+#ifndef __RENAME_SIM_HH__
+#define __RENAME_SIM_HH__
+
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <vector>
+
+#include "free_list.hh"
+#include "reg_class.hh"
+#include "regfile_banked.hh"
+#include "regfile_o3.hh"
+#include "rename_map.hh"
+#include "trace.hh"
+
+namespace workflow
+{
+
+/**
+ * Complete state of a rename setup, with physical registers named by
+ * flat index so that it can be copied between simulator instances.
+ */
+struct RenameState
+{
+    /** Physical register mapped to each architectural register. */
+    std::vector<RegIndex> archToPhys;
+    /** Free physical registers, in allocation order. */
+    std::vector<RegIndex> freeRegs;
+    /** Value held by each physical register. */
+    std::vector<RegVal> regValues;
+    /**
+     * Renames of each architectural register still to reuse its pinned
+     * register; its writes are all complete.
+     */
+    std::vector<uint16_t> pinnedRenames;
+
+    /**
+     * Arch register i mapped to physical register i, the remaining
+     * physical registers free, all values zero, nothing pinned.
+     */
+    static RenameState initial(unsigned num_arch_regs,
+                               unsigned num_phys_regs);
+};
+
+/** Statistics of a trace replay; mergeable across intervals. */
+struct SimStats
+{
+    uint64_t numInsts = 0;
+    uint64_t numSrcReads = 0;
+    uint64_t numRegWrites = 0;
+    uint64_t numMoves = 0;
+    /** Moves renamed to their source's register, not executed. */
+    uint64_t numEliminatedMoves = 0;
+    /** Sum of all source values read, to compare runs cheaply. */
+    uint64_t readChecksum = 0;
+    /** Lowest number of free registers seen after a rename. */
+    unsigned minFreeRegs = UINT_MAX;
+
+    void merge(const SimStats &other);
+    void print(std::ostream &os) const;
+};
+
+/**
+ * The rename structures of one simulated core: a PhysRegFile, the free
+ * list of its registers and the RenameMap allocating from it, starting
+ * from RenameState::initial(). A banked register file uses a
+ * BankedFreeList in place of freeList.
+ *
+ * With move elimination on, a move maps its destination to the physical
+ * register of its source, and refCounts keeps the number of mappings to
+ * each register: those in the rename map plus the previous mappings of
+ * instructions not yet committed. releaseReg() frees a register only
+ * when its last mapping dies.
+ *
+ * A rename that maps its destination to the register it already had,
+ * reusing a pinned register or eliminating a move between registers
+ * sharing one, returns it as both the new and the previous mapping and
+ * must not release it; see freesPrev().
+ */
+class RenameContext
+{
+  public:
+    const RegClass &regClass;
+    PhysRegFile regFile;
+    SimpleFreeList freeList;
+    std::unique_ptr<BankedFreeList> bankedFreeList;
+    RenameMap renameMap;
+    /** Physical register ids by flat index. */
+    std::vector<PhysRegIdPtr> physRegs;
+    /** Mappings per physical register; empty without move elimination. */
+    std::vector<uint16_t> refCounts;
+
+    /**
+     * @param reg_class Architectural register class; its numRegs() is
+     * the number of architectural registers.
+     */
+    RenameContext(const RegClass &reg_class, unsigned num_phys_regs,
+                  const BankConfig &banks = BankConfig());
+
+    // The rename map and free list point into this object.
+    RenameContext(const RenameContext &) = delete;
+    RenameContext &operator=(const RenameContext &) = delete;
+
+    /** Replace the whole rename state. */
+    void loadState(const RenameState &state);
+    void saveState(RenameState &state) const;
+
+    /** The RegId of architectural register idx. */
+    RegId archReg(RegIndex idx) const { return regClass[idx]; }
+
+    /**
+     * Turn move elimination on or off, counting the mappings of the
+     * current state. No renamed instruction may be uncommitted.
+     */
+    void setMoveElimination(bool enable);
+    bool moveElimination() const { return !refCounts.empty(); }
+
+    /** True iff renaming rec shares a register instead of allocating. */
+    bool
+    eliminates(const TraceRecord &rec) const
+    {
+        return rec.isMove && moveElimination();
+    }
+
+    /**
+     * Rename the destination of rec, which must be committed with
+     * releaseReg() of the previous mapping returned if freesPrev().
+     */
+    RenameMap::RenameInfo
+    renameDest(const TraceRecord &rec)
+    {
+        if (!moveElimination())
+            return renameMap.rename(destReg(rec));
+        return renameCounted(rec);
+    }
+
+    /** True iff committing info releases its previous mapping. */
+    static bool
+    freesPrev(const RenameMap::RenameInfo &info)
+    {
+        return info.first != info.second;
+    }
+
+    /** Drop a mapping of reg, freeing reg if it was the last. */
+    void
+    releaseReg(PhysRegIdPtr reg)
+    {
+        if (!moveElimination() || --refCounts[reg->flatIndex()] == 0)
+            addFreeReg(reg);
+    }
+
+    /** Free list operations, whichever list is in use. */
+    /** @{ */
+    void
+    addFreeReg(PhysRegIdPtr reg)
+    {
+        if (bankedFreeList)
+            bankedFreeList->addReg(reg);
+        else
+            freeList.addReg(reg);
+    }
+
+    unsigned
+    numFreeRegs() const
+    {
+        return bankedFreeList ? bankedFreeList->numFreeRegs() :
+            freeList.numFreeRegs();
+    }
+
+    bool hasFreeRegs() const { return numFreeRegs() != 0; }
+    /** @} */
+
+  private:
+    /** The RegId of rec's destination, with its pinned writes. */
+    RegId
+    destReg(const TraceRecord &rec) const
+    {
+        RegId reg = archReg(rec.dest);
+        reg.setNumPinnedWrites(rec.numPinnedWrites);
+        return reg;
+    }
+
+    /** renameDest() keeping refCounts. */
+    RenameMap::RenameInfo renameCounted(const TraceRecord &rec);
+    void countMappings();
+};
+
+/**
+ * Functional replay of trace records through a RenameContext. Each
+ * instruction reads its sources, renames and writes its destination, and
+ * commits at once, returning the previous mapping to the free list.
+ */
+class RenameSim
+{
+  private:
+    RenameContext ctx;
+    SimStats _stats;
+
+  public:
+    RenameSim(const RegClass &reg_class, unsigned num_phys_regs,
+              const BankConfig &banks = BankConfig())
+        : ctx(reg_class, num_phys_regs, banks)
+    {}
+
+    /** Replace the whole simulator state. */
+    void loadState(const RenameState &state) { ctx.loadState(state); }
+    void saveState(RenameState &state) const { ctx.saveState(state); }
+
+    void setMoveElimination(bool enable) { ctx.setMoveElimination(enable); }
+
+    /** Replay one instruction. */
+    void execute(const TraceRecord &rec);
+
+    void
+    execute(const TraceRecord *first, const TraceRecord *last)
+    {
+        for (; first != last; ++first)
+            execute(*first);
+    }
+
+    const SimStats &stats() const { return _stats; }
+    void resetStats() { _stats = SimStats(); }
+
+    RenameContext &context() { return ctx; }
+    const RenameContext &context() const { return ctx; }
+};
+
+/**
+ * Advance state over the records [first, last) tracking only what
+ * determines later state: the mappings, the free list order, the
+ * register values and the renames left to reuse pinned registers.
+ * Produces the same state RenameSim would without move elimination,
+ * much faster.
+ */
+void fastForward(RenameState &state, const TraceRecord *first,
+                 const TraceRecord *last);
+
+} // namespace workflow
+
+#endif // __RENAME_SIM_HH__
@@ -0,0 +1,200 @@
+#include "replacement_policies.hh"
+
+#include <cassert>
+
+#include "intmath.hh"
+
+namespace workflow
+{
+
+ListRP::ListRP(size_t num_sets, unsigned num_ways, bool touch_on_access)
+    : ReplacementPolicy(num_sets, num_ways), touchOnAccess(touch_on_access),
+      prev(num_sets * num_ways), next(num_sets * num_ways),
+      head(num_sets), tail(num_sets)
+{
+    assert(num_ways > 0);
+    // Start every set with way 0 as the most recently used.
+    for (size_t set = 0; set < num_sets; set++) {
+        const size_t base = set * num_ways;
+        for (unsigned way = 0; way < num_ways; way++) {
+            prev[base + way] = way - 1;
+            next[base + way] = way + 1;
+        }
+        head[set] = 0;
+        tail[set] = num_ways - 1;
+    }
+}
+
+void
+ListRP::unlink(size_t set, unsigned way)
+{
+    const size_t base = set * numWays;
+    const uint32_t p = prev[base + way];
+    const uint32_t n = next[base + way];
+    if (way == head[set])
+        head[set] = n;
+    else
+        next[base + p] = n;
+    if (way == tail[set])
+        tail[set] = p;
+    else
+        prev[base + n] = p;
+}
+
+void
+ListRP::pushFront(size_t set, unsigned way)
+{
+    const size_t base = set * numWays;
+    prev[base + way] = UINT32_MAX;
+    next[base + way] = head[set];
+    prev[base + head[set]] = way;
+    head[set] = way;
+}
+
+void
+ListRP::pushBack(size_t set, unsigned way)
+{
+    const size_t base = set * numWays;
+    next[base + way] = UINT32_MAX;
+    prev[base + way] = tail[set];
+    next[base + tail[set]] = way;
+    tail[set] = way;
+}
+
+void
+ListRP::reset(size_t set, unsigned way)
+{
+    if (numWays == 1 || head[set] == way)
+        return;
+    unlink(set, way);
+    pushFront(set, way);
+}
+
+void
+ListRP::touch(size_t set, unsigned way)
+{
+    if (touchOnAccess)
+        reset(set, way);
+}
+
+void
+ListRP::invalidate(size_t set, unsigned way)
+{
+    if (numWays == 1 || tail[set] == way)
+        return;
+    unlink(set, way);
+    pushBack(set, way);
+}
+
+TreePLRURP::TreePLRURP(size_t num_sets, unsigned num_ways)
+    : ReplacementPolicy(num_sets, num_ways),
+      numLeaves(nextPow2(num_ways)),
+      bits((num_sets * (numLeaves - 1) + 63) / 64)
+{
+    assert(num_ways > 0);
+}
+
+bool
+TreePLRURP::getBit(size_t set, unsigned node) const
+{
+    const size_t pos = set * (numLeaves - 1) + node - 1;
+    return (bits[pos >> 6] >> (pos & 63)) & 1;
+}
+
+void
+TreePLRURP::setBit(size_t set, unsigned node, bool val)
+{
+    const size_t pos = set * (numLeaves - 1) + node - 1;
+    const uint64_t mask = uint64_t(1) << (pos & 63);
+    bits[pos >> 6] = (bits[pos >> 6] & ~mask) | (val ? mask : 0);
+}
+
+void
+TreePLRURP::mark(size_t set, unsigned way, bool hot)
+{
+    unsigned node = 1;
+    for (unsigned span = numLeaves >> 1; span > 0; span >>= 1) {
+        const bool dir = way & span;
+        // A set bit sends the victim search right.
+        setBit(set, node, hot ? !dir : dir);
+        node = 2 * node + dir;
+    }
+}
+
+unsigned
+TreePLRURP::getVictim(size_t set)
+{
+    unsigned node = 1;
+    unsigned lo = 0;
+    for (unsigned span = numLeaves >> 1; span > 0; span >>= 1) {
+        bool dir = getBit(set, node);
+        // Leaves past numWays do not exist; never descend into them.
+        if (dir && lo + span >= numWays)
+            dir = false;
+        node = 2 * node + dir;
+        lo += dir ? span : 0;
+    }
+    return lo;
+}
+
+RandomRP::RandomRP(size_t num_sets, unsigned num_ways, uint64_t seed)
+    : ReplacementPolicy(num_sets, num_ways), state(seed ? seed : 1)
+{
+    assert(num_ways > 0);
+}
+
+unsigned
+RandomRP::getVictim(size_t)
+{
+    return xorshift64(state) % numWays;
+}
+
+std::unique_ptr<ReplacementPolicy>
+makeReplacementPolicy(ReplacementPolicyType type, size_t num_sets,
+                      unsigned num_ways)
+{
+    switch (type) {
+      case ReplacementPolicyType::LRU:
+        return std::make_unique<ListRP>(num_sets, num_ways, true);
+      case ReplacementPolicyType::FIFO:
+        return std::make_unique<ListRP>(num_sets, num_ways, false);
+      case ReplacementPolicyType::TreePLRU:
+        return std::make_unique<TreePLRURP>(num_sets, num_ways);
+      case ReplacementPolicyType::Random:
+        return std::make_unique<RandomRP>(num_sets, num_ways);
+    }
+    return nullptr;
+}
+
+const char *
+replacementPolicyName(ReplacementPolicyType type)
+{
+    switch (type) {
+      case ReplacementPolicyType::LRU:
+        return "lru";
+      case ReplacementPolicyType::TreePLRU:
+        return "tree-plru";
+      case ReplacementPolicyType::Random:
+        return "random";
+      case ReplacementPolicyType::FIFO:
+        return "fifo";
+    }
+    return "unknown";
+}
+
+bool
+parseReplacementPolicy(const std::string &name, ReplacementPolicyType &type)
+{
+    for (ReplacementPolicyType t : {ReplacementPolicyType::LRU,
+                                    ReplacementPolicyType::TreePLRU,
+                                    ReplacementPolicyType::Random,
+                                    ReplacementPolicyType::FIFO}) {
+        if (name == replacementPolicyName(t)) {
+            type = t;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace workflow
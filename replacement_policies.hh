@@ -0,0 +1,139 @@
+#ifndef __REPLACEMENT_POLICIES_HH__
+#define __REPLACEMENT_POLICIES_HH__
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace workflow
+{
+
+enum class ReplacementPolicyType
+{
+    LRU,
+    TreePLRU,
+    Random,
+    FIFO
+};
+
+/**
+ * Victim selection for a structure organized as sets of ways. A fully
+ * associative structure is a single set. Metadata lives in flat arrays
+ * owned by the policy and indexed by (set, way); callers never hold
+ * per-entry policy objects.
+ */
+class ReplacementPolicy
+{
+  protected:
+    const size_t numSets;
+    const unsigned numWays;
+
+  public:
+    ReplacementPolicy(size_t num_sets, unsigned num_ways)
+        : numSets(num_sets), numWays(num_ways)
+    {}
+
+    virtual ~ReplacementPolicy() {}
+
+    /** Entry (set, way) has just been filled. */
+    virtual void reset(size_t set, unsigned way) = 0;
+
+    /** Entry (set, way) has been accessed. */
+    virtual void touch(size_t set, unsigned way) = 0;
+
+    /** Entry (set, way) has been vacated; prefer it as the next victim. */
+    virtual void invalidate(size_t set, unsigned way) = 0;
+
+    /** Choose the way to replace in a full set. */
+    virtual unsigned getVictim(size_t set) = 0;
+};
+
+/**
+ * Recency ordered list per set, kept as 32-bit prev/next links per entry.
+ * With touchOnAccess false the order is insertion order, i.e. FIFO.
+ */
+class ListRP : public ReplacementPolicy
+{
+  private:
+    const bool touchOnAccess;
+    /** Links by flat entry index (set * numWays + way). */
+    std::vector<uint32_t> prev;
+    std::vector<uint32_t> next;
+    /** Most and least recently used way per set. */
+    std::vector<uint32_t> head;
+    std::vector<uint32_t> tail;
+
+    void unlink(size_t set, unsigned way);
+    void pushFront(size_t set, unsigned way);
+    void pushBack(size_t set, unsigned way);
+
+  public:
+    ListRP(size_t num_sets, unsigned num_ways, bool touch_on_access);
+
+    void reset(size_t set, unsigned way) override;
+    void touch(size_t set, unsigned way) override;
+    void invalidate(size_t set, unsigned way) override;
+    unsigned getVictim(size_t set) override { return tail[set]; }
+};
+
+/**
+ * Tree pseudo-LRU: one bit per internal node of a binary tree over the
+ * ways of each set, each bit pointing towards the colder half.
+ */
+class TreePLRURP : public ReplacementPolicy
+{
+  private:
+    /** Number of leaves per tree (numWays rounded up to a power of 2). */
+    const unsigned numLeaves;
+    /** Packed node bits, numLeaves - 1 per set, heap ordered from 1. */
+    std::vector<uint64_t> bits;
+
+    bool getBit(size_t set, unsigned node) const;
+    void setBit(size_t set, unsigned node, bool val);
+    /** Point the path to way towards (hot) or away from (!hot) it. */
+    void mark(size_t set, unsigned way, bool hot);
+
+  public:
+    TreePLRURP(size_t num_sets, unsigned num_ways);
+
+    void reset(size_t set, unsigned way) override { mark(set, way, true); }
+    void touch(size_t set, unsigned way) override { mark(set, way, true); }
+    void
+    invalidate(size_t set, unsigned way) override
+    {
+        mark(set, way, false);
+    }
+    unsigned getVictim(size_t set) override;
+};
+
+/** Uniformly random victim; no per-entry state at all. */
+class RandomRP : public ReplacementPolicy
+{
+  private:
+    uint64_t state;
+
+  public:
+    RandomRP(size_t num_sets, unsigned num_ways, uint64_t seed = 1);
+
+    void reset(size_t, unsigned) override {}
+    void touch(size_t, unsigned) override {}
+    void invalidate(size_t, unsigned) override {}
+    unsigned getVictim(size_t) override;
+};
+
+/** Build the policy of the given type for num_sets x num_ways entries. */
+std::unique_ptr<ReplacementPolicy>
+makeReplacementPolicy(ReplacementPolicyType type, size_t num_sets,
+                      unsigned num_ways);
+
+/** Printable name of a policy type. */
+const char *replacementPolicyName(ReplacementPolicyType type);
+
+/** Inverse of replacementPolicyName; false if name is unknown. */
+bool parseReplacementPolicy(const std::string &name,
+                            ReplacementPolicyType &type);
+
+} // namespace workflow
+
+#endif // __REPLACEMENT_POLICIES_HH__
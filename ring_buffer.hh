@@ -0,0 +1,85 @@
+#ifndef __RING_BUFFER_HH__
+#define __RING_BUFFER_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include "intmath.hh"
+
+namespace workflow
+{
+
+/**
+ * Fixed-capacity FIFO queue. Storage is allocated once, rounded up to a
+ * power of two so that wrapping is a mask; the logical capacity is
+ * enforced separately.
+ */
+template <class T>
+class RingBuffer
+{
+  private:
+    std::vector<T> buf;
+    size_t mask;
+    size_t _capacity;
+    size_t head = 0;
+    size_t count = 0;
+
+  public:
+    explicit RingBuffer(size_t capacity = 1) { resize(capacity); }
+
+    /** Empty the queue and change its capacity. */
+    void
+    resize(size_t capacity)
+    {
+        assert(capacity > 0);
+        const size_t storage = nextPow2(capacity);
+        if (storage > buf.size())
+            buf.resize(storage);
+        mask = buf.size() - 1;
+        _capacity = capacity;
+        clear();
+    }
+
+    void clear() { head = count = 0; }
+
+    size_t capacity() const { return _capacity; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    bool full() const { return count == _capacity; }
+    size_t space() const { return _capacity - count; }
+
+    void
+    push(const T &val)
+    {
+        assert(!full());
+        buf[(head + count++) & mask] = val;
+    }
+
+    /** Append a default element and return it for filling in place. */
+    T &
+    pushBack()
+    {
+        assert(!full());
+        return buf[(head + count++) & mask];
+    }
+
+    T &front() { assert(!empty()); return buf[head]; }
+    const T &front() const { assert(!empty()); return buf[head]; }
+
+    void
+    pop()
+    {
+        assert(!empty());
+        head = (head + 1) & mask;
+        count--;
+    }
+
+    /** Element i positions behind the front. */
+    T &operator[](size_t i) { return buf[(head + i) & mask]; }
+    const T &operator[](size_t i) const { return buf[(head + i) & mask]; }
+};
+
+} // namespace workflow
+
+#endif // __RING_BUFFER_HH__
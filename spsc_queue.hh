@@ -0,0 +1,107 @@
+#ifndef __SPSC_QUEUE_HH__
+#define __SPSC_QUEUE_HH__
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+
+#include "intmath.hh"
+
+namespace workflow
+{
+
+/** Assumed destructive interference size. */
+static constexpr size_t CacheLineBytes = 64;
+
+/**
+ * Bounded lock-free single-producer single-consumer queue.
+ *
+ * Producer and consumer indices live on separate cache lines, each next
+ * to the owner's cached copy of the other index, so the indices only
+ * bounce between cores when a side runs out of cached slack. Elements
+ * are filled and drained in place: the producer writes into pushSlot()
+ * and publishes it with commitPush(); the consumer reads front() and
+ * releases it with pop().
+ */
+template <class T>
+class SPSCQueue
+{
+  private:
+    const size_t mask;
+    std::unique_ptr<T[]> slots;
+
+    /** Producer side. */
+    alignas(CacheLineBytes) std::atomic<size_t> tail{0};
+    size_t cachedHead = 0;
+
+    /** Consumer side. */
+    alignas(CacheLineBytes) std::atomic<size_t> head{0};
+    size_t cachedTail = 0;
+
+  public:
+    /** @param capacity Slots, rounded up to a power of two. */
+    explicit SPSCQueue(size_t capacity)
+        : mask(nextPow2(capacity) - 1), slots(new T[mask + 1])
+    {}
+
+    /** Producer: the slot to fill next, or nullptr if the queue is full. */
+    T *
+    pushSlot()
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask)
+                return nullptr;
+        }
+        return &slots[t & mask];
+    }
+
+    /** Producer: publish the slot returned by pushSlot(). */
+    void
+    commitPush()
+    {
+        tail.store(tail.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+
+    /** Consumer: the oldest element, or nullptr if the queue is empty. */
+    T *
+    front()
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail)
+                return nullptr;
+        }
+        return &slots[h & mask];
+    }
+
+    /** Consumer: release the element returned by front(). */
+    void
+    pop()
+    {
+        head.store(head.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_release);
+    }
+};
+
+/** A fixed-size group of records moved through an SPSCQueue at once. */
+template <class T, size_t N>
+struct Batch
+{
+    static constexpr size_t Capacity = N;
+
+    size_t count = 0;
+    /** Set on the final batch of a stream. */
+    bool last = false;
+    T items[N];
+
+    bool full() const { return count == N; }
+};
+
+} // namespace workflow
+
+#endif // __SPSC_QUEUE_HH__
@@ -0,0 +1,103 @@
+#ifndef __STATIC_RENAME_MAP_HH__
+#define __STATIC_RENAME_MAP_HH__
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "reg_class.hh"
+
+namespace workflow
+{
+
+/**
+ * Rename map for an ISA with a fixed number of architectural registers.
+ *
+ * Unlike RenameMap the table is a std::array sized at compile time, so
+ * there is no init() and no bounds bookkeeping, and the bulk operations
+ * below are fixed-length loops the compiler can unroll or vectorize.
+ * Handle is whatever names a physical register: a PhysRegIdPtr, or a flat
+ * RegIndex for functional models that keep no PhysRegId objects. Pinned
+ * writes are not modelled.
+ */
+template <size_t NumArchRegs, class Handle = PhysRegIdPtr>
+class StaticRenameMap
+{
+  public:
+    /** A copy of the whole table. */
+    using Snapshot = std::array<Handle, NumArchRegs>;
+    using iterator = typename Snapshot::iterator;
+    using const_iterator = typename Snapshot::const_iterator;
+
+  private:
+    Snapshot map{};
+
+  public:
+    static constexpr size_t numArchRegs() { return NumArchRegs; }
+
+    Handle lookup(RegIndex arch_reg) const { return map[arch_reg]; }
+
+    void
+    setEntry(RegIndex arch_reg, Handle phys_reg)
+    {
+        map[arch_reg] = phys_reg;
+    }
+
+    Handle &operator[](RegIndex arch_reg) { return map[arch_reg]; }
+
+    const Handle &
+    operator[](RegIndex arch_reg) const
+    {
+        return map[arch_reg];
+    }
+
+    /** Bulk operations over the whole table. */
+    /** @{ */
+    /** A copy of the table, unaffected by later renames. */
+    Snapshot snapshot() const { return map; }
+    void restore(const Snapshot &snap) { map = snap; }
+
+    /** True iff every mapping equals the one in snap. */
+    bool
+    matches(const Snapshot &snap) const
+    {
+        // No early exit, so the loop has a fixed trip count.
+        bool diff = false;
+        for (size_t i = 0; i < NumArchRegs; i++)
+            diff |= map[i] != snap[i];
+        return !diff;
+    }
+
+    /** Number of architectural registers mapped differently in snap. */
+    size_t
+    countDifferences(const Snapshot &snap) const
+    {
+        size_t diffs = 0;
+        for (size_t i = 0; i < NumArchRegs; i++)
+            diffs += map[i] != snap[i];
+        return diffs;
+    }
+
+    /** Copy NumArchRegs mappings in from, or out to, flat storage. */
+    void
+    load(const Handle *src)
+    {
+        std::copy_n(src, NumArchRegs, map.begin());
+    }
+
+    void
+    store(Handle *dst) const
+    {
+        std::copy_n(map.begin(), NumArchRegs, dst);
+    }
+    /** @} */
+
+    iterator begin() { return map.begin(); }
+    const_iterator begin() const { return map.begin(); }
+    iterator end() { return map.end(); }
+    const_iterator end() const { return map.end(); }
+};
+
+} // namespace workflow
+
+#endif // __STATIC_RENAME_MAP_HH__
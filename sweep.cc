@@ -0,0 +1,169 @@
+#include "sweep.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+
+#include "cam.hh"
+
+namespace workflow
+{
+
+void
+SweepResult::printCSVHeader(std::ostream &os)
+{
+    os << "cam_size,phys_regs,rename_width,insts,cycles,ipc,seconds,"
+          "minsts_per_sec,avg_free_regs,avg_rename_queue,"
+          "free_list_empty_cycles,rename_queue_full_cycles,"
+          "cam_entries,cam_occupancy,cam_hits,cam_evictions,cam_seconds,"
+          "cap_reads,cap_read_faults,cap_writes,cap_write_faults,"
+          "l1_accesses,l1_hit_rate,l1_compulsory_misses,"
+          "l1_capacity_misses,l1_conflict_misses,l1_writebacks\n";
+}
+
+void
+SweepResult::printCSV(std::ostream &os) const
+{
+    const double minsts =
+        seconds > 0 ? stats.dispatchedInsts / seconds / 1e6 : 0.0;
+    os << point.camSize << ',' << point.numPhysRegs << ','
+       << point.renameWidth << ',' << stats.dispatchedInsts << ','
+       << stats.cycles << ',' << stats.ipc() << ',' << seconds << ','
+       << minsts << ',' << stats.avgFreeRegs() << ','
+       << stats.avgRenameQueue() << ',' << stats.freeListEmptyCycles << ','
+       << stats.renameQueueFullCycles << ',' << camEntries << ','
+       << double(camEntries) / point.camSize << ',' << camHits << ','
+       << camEvictions << ',' << camSeconds << ',' << capChecks.reads
+       << ',' << capChecks.readFaults << ',' << capChecks.writes << ','
+       << capChecks.writeFaults << ',' << l1.accesses() << ','
+       << l1.hitRate() << ',' << l1.compulsoryMisses << ','
+       << l1.capacityMisses << ',' << l1.conflictMisses << ','
+       << l1.writebacks << '\n';
+}
+
+std::vector<SweepPoint>
+sweepPoints(const SweepConfig &config)
+{
+    std::vector<SweepPoint> points;
+    for (unsigned phys : config.physRegs)
+        for (size_t cam : config.camSizes)
+            for (unsigned width : config.renameWidths)
+                points.push_back({cam, phys, width});
+    return points;
+}
+
+namespace
+{
+
+/** Per-thread simulation state, reused across the points it runs. */
+class SweepWorker
+{
+  private:
+    const RegClass &regClass;
+    const std::vector<TraceRecord> &trace;
+
+    std::unique_ptr<Pipeline> pipeline;
+    RenameState initial;
+    std::unique_ptr<CAM> cam;
+    std::vector<RegId> archRegs;
+
+  public:
+    SweepWorker(const RegClass &reg_class,
+                const std::vector<TraceRecord> &_trace)
+        : regClass(reg_class), trace(_trace),
+          archRegs(reg_class.begin(), reg_class.end())
+    {}
+
+    void
+    run(const SweepPoint &point, const SweepConfig &sweep,
+        SweepResult &result)
+    {
+        PipelineConfig config = sweep.pipeline;
+        config.renameWidth = point.renameWidth;
+        if (!pipeline || initial.regValues.size() != point.numPhysRegs) {
+            initial = RenameState::initial(regClass.numRegs(),
+                                           point.numPhysRegs);
+            pipeline = std::make_unique<Pipeline>(
+                    regClass, point.numPhysRegs, config);
+        } else {
+            pipeline->reset(config, initial);
+        }
+        PhysRegFile &reg_file = pipeline->context().regFile;
+        if (sweep.checkCaps)
+            reg_file.setCheckedAccess(sweep.checkRead, sweep.checkWrite);
+        reg_file.resetCapCheckStats();
+        pipeline->setTrace(trace.data(), trace.data() + trace.size());
+
+        auto start = std::chrono::steady_clock::now();
+        pipeline->run();
+        result.seconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        start = std::chrono::steady_clock::now();
+
+        if (!cam || cam->getMaxSize() != point.camSize) {
+            cam = std::make_unique<CAM>(point.camSize);
+            cam->setReplacementPolicy(ReplacementPolicyType::LRU);
+        } else {
+            cam->clear();
+        }
+        uint64_t hits = 0;
+        uint64_t evictions = 0;
+        for (const TraceRecord &rec : trace) {
+            // A move names no new capability.
+            if (rec.isMove)
+                continue;
+            CAMInsertResult res = cam->add(rec.value, &archRegs[rec.dest]);
+            hits += res.status == CAMInsertResult::Updated;
+            evictions += res.status == CAMInsertResult::Evicted;
+        }
+
+        result.camSeconds = std::chrono::duration<double>(
+                std::chrono::steady_clock::now() - start).count();
+
+        result.point = point;
+        result.stats = pipeline->stats();
+        result.capChecks = reg_file.capCheckStats();
+        if (const L1Cache *l1 = pipeline->l1Cache())
+            result.l1 = l1->stats();
+        result.camEntries = cam->size();
+        result.camHits = hits;
+        result.camEvictions = evictions;
+    }
+};
+
+} // anonymous namespace
+
+std::vector<SweepResult>
+runSweep(const RegClass &reg_class, const std::vector<TraceRecord> &trace,
+         const SweepConfig &config)
+{
+    const std::vector<SweepPoint> points = sweepPoints(config);
+    std::vector<SweepResult> results(points.size());
+
+    unsigned num_threads = config.numThreads;
+    if (num_threads == 0)
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    num_threads = std::min<size_t>(num_threads,
+                                   std::max<size_t>(1, points.size()));
+
+    std::atomic<size_t> next_point{0};
+    auto worker = [&]() {
+        SweepWorker state(reg_class, trace);
+        size_t i;
+        while ((i = next_point.fetch_add(1)) < points.size())
+            state.run(points[i], config, results[i]);
+    };
+
+    std::vector<std::thread> threads;
+    for (unsigned id = 1; id < num_threads; id++)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &t : threads)
+        t.join();
+    return results;
+}
+
+} // namespace workflow
@@ -0,0 +1,78 @@
+#ifndef __SWEEP_HH__
+#define __SWEEP_HH__
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "capability.hh"
+#include "pipeline.hh"
+#include "regfile_o3.hh"
+#include "trace.hh"
+
+namespace workflow
+{
+
+struct SweepConfig
+{
+    /** Values of each swept parameter; every combination is a point. */
+    std::vector<size_t> camSizes = {512};
+    std::vector<unsigned> physRegs = {128};
+    std::vector<unsigned> renameWidths = {4};
+    /** Worker threads; 0 uses every hardware thread. */
+    unsigned numThreads = 0;
+    /** Settings shared by every point; renameWidth is overridden. */
+    PipelineConfig pipeline;
+    /** Check accesses; see PhysRegFile::setCheckedAccess(). */
+    bool checkCaps = false;
+    CapAccessMask checkRead = {};
+    CapAccessMask checkWrite = {};
+};
+
+struct SweepPoint
+{
+    size_t camSize;
+    unsigned numPhysRegs;
+    unsigned renameWidth;
+};
+
+struct SweepResult
+{
+    SweepPoint point;
+    PipelineStats stats;
+    /** Capability checks; zero unless SweepConfig::checkCaps. */
+    CapCheckStats capChecks;
+    /** L1 model; zero unless the pipeline config enables it. */
+    L1CacheStats l1;
+    /** Wall time of the point's pipeline run on its worker. */
+    double seconds = 0;
+    /** Wall time of the CAM replay, kept apart from seconds. */
+    double camSeconds = 0;
+
+    /** CAM of capability values to the registers last written with them. */
+    size_t camEntries = 0;
+    uint64_t camHits = 0;
+    uint64_t camEvictions = 0;
+
+    static void printCSVHeader(std::ostream &os);
+    void printCSV(std::ostream &os) const;
+};
+
+/** Every combination of the swept values, physical registers outermost. */
+std::vector<SweepPoint> sweepPoints(const SweepConfig &config);
+
+/**
+ * Run every point of the sweep over the same in-memory trace.
+ *
+ * Workers claim points in order and each runs a Pipeline and a CAM of its
+ * own. Consecutive points with the same register count reset the
+ * worker's pipeline instead of rebuilding it, and its CAM is only rebuilt
+ * when the CAM size changes. Results are in sweepPoints() order.
+ */
+std::vector<SweepResult> runSweep(const RegClass &reg_class,
+                                  const std::vector<TraceRecord> &trace,
+                                  const SweepConfig &config);
+
+} // namespace workflow
+
+#endif // __SWEEP_HH__
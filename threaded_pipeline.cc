@@ -0,0 +1,249 @@
+#include "threaded_pipeline.hh"
+
+#include <thread>
+
+namespace workflow
+{
+
+void
+ThreadedPipelineStats::print(std::ostream &os) const
+{
+    os << "insts " << numInsts << '\n';
+    PipelineBaseStats::print(os);
+    os << "decodeOutputFull " << decodeOutputFull << '\n'
+       << "renameOutputFull " << renameOutputFull << '\n'
+       << "renameFreeListEmpty " << renameFreeListEmpty << '\n'
+       << "renameInputEmpty " << renameInputEmpty << '\n'
+       << "writeInputEmpty " << writeInputEmpty << '\n';
+}
+
+ThreadedPipeline::ThreadedPipeline(const RegClass &reg_class,
+                                   unsigned num_phys_regs,
+                                   const ThreadedPipelineConfig &_config)
+    : config(_config), ctx(reg_class, num_phys_regs, _config.banks)
+{
+    // Only the update thread touches the register file, so the cache
+    // needs no synchronization.
+    ctx.regFile.setRegCache(config.regCache);
+    ctx.setMoveElimination(config.moveElimination);
+}
+
+template <class Source>
+void
+ThreadedPipeline::decodeStage(Source &next, SPSCQueue<RecordBatch> &out)
+{
+    uint64_t output_full = 0;
+    bool more = true;
+    while (more) {
+        RecordBatch *batch;
+        while (!(batch = out.pushSlot())) {
+            output_full++;
+            std::this_thread::yield();
+        }
+        batch->count = 0;
+        while (batch->count < BatchSize) {
+            if (!next(batch->items[batch->count])) {
+                more = false;
+                break;
+            }
+            batch->count++;
+        }
+        batch->last = !more;
+        out.commitPush();
+    }
+    _stats.decodeOutputFull = output_full;
+}
+
+void
+ThreadedPipeline::renameStage(SPSCQueue<RecordBatch> &in,
+                              SPSCQueue<RenamedBatch> &out,
+                              SPSCQueue<FreeBatch> &freed)
+{
+    uint64_t output_full = 0;
+    uint64_t free_list_empty = 0;
+    uint64_t input_empty = 0;
+    uint64_t moves = 0;
+    uint64_t eliminated_moves = 0;
+    bool update_done = false;
+
+    auto drain_freed = [&]() {
+        bool got = false;
+        FreeBatch *batch;
+        while ((batch = freed.front())) {
+            for (size_t i = 0; i < batch->count; i++) {
+                if (batch->items[i])
+                    ctx.releaseReg(batch->items[i]);
+            }
+            update_done = batch->last;
+            freed.pop();
+            got = true;
+        }
+        return got;
+    };
+
+    RenamedBatch *outb = nullptr;
+    auto open_output = [&]() {
+        // Keep accepting returned registers while blocked, or update
+        // could block on us in turn.
+        while (!(outb = out.pushSlot())) {
+            output_full++;
+            drain_freed();
+            std::this_thread::yield();
+        }
+        outb->count = 0;
+        outb->last = false;
+    };
+    auto flush_output = [&](bool last) {
+        outb->last = last;
+        out.commitPush();
+        outb = nullptr;
+    };
+
+    bool last = false;
+    while (!last) {
+        RecordBatch *inb;
+        while (!(inb = in.front())) {
+            input_empty++;
+            drain_freed();
+            std::this_thread::yield();
+        }
+
+        for (size_t i = 0; i < inb->count; i++) {
+            const TraceRecord &rec = inb->items[i];
+            const bool eliminate = ctx.eliminates(rec);
+            while (!eliminate && !ctx.hasFreeRegs()) {
+                if (drain_freed())
+                    continue;
+                free_list_empty++;
+                // Registers only come back for instructions update has
+                // seen, so hand over what is pending before waiting.
+                if (outb && outb->count)
+                    flush_output(false);
+                std::this_thread::yield();
+            }
+            if (!outb)
+                open_output();
+
+            RenamedInst &inst = outb->items[outb->count++];
+            inst.isMove = rec.isMove;
+            inst.eliminated = eliminate;
+            inst.numSrcs = eliminate ? 0 : rec.numSrcs;
+            for (unsigned s = 0; s < inst.numSrcs; s++)
+                inst.srcs[s] =
+                    ctx.renameMap.lookup(ctx.archReg(rec.srcs[s]));
+            RenameMap::RenameInfo info = ctx.renameDest(rec);
+            inst.dest = info.first;
+            inst.prevDest = ctx.freesPrev(info) ? info.second : nullptr;
+            inst.value = rec.value;
+            moves += rec.isMove;
+            eliminated_moves += eliminate;
+
+            if (outb->full())
+                flush_output(false);
+        }
+        last = inb->last;
+        in.pop();
+    }
+    if (!outb)
+        open_output();
+    flush_output(true);
+
+    // Collect the remaining returns so the free list ends up complete.
+    while (!update_done) {
+        if (!drain_freed())
+            std::this_thread::yield();
+    }
+
+    _stats.renameOutputFull = output_full;
+    _stats.renameFreeListEmpty = free_list_empty;
+    _stats.renameInputEmpty = input_empty;
+    _stats.moves = moves;
+    _stats.eliminatedMoves = eliminated_moves;
+}
+
+void
+ThreadedPipeline::updateStage(SPSCQueue<RenamedBatch> &in,
+                              SPSCQueue<FreeBatch> &freed)
+{
+    uint64_t num_insts = 0;
+    uint64_t reg_reads = 0;
+    uint64_t reg_writes = 0;
+    uint64_t checksum = 0;
+    uint64_t input_empty = 0;
+
+    bool last = false;
+    while (!last) {
+        RenamedBatch *inb;
+        while (!(inb = in.front())) {
+            input_empty++;
+            std::this_thread::yield();
+        }
+        FreeBatch *outb;
+        while (!(outb = freed.pushSlot()))
+            std::this_thread::yield();
+
+        for (size_t i = 0; i < inb->count; i++) {
+            const RenamedInst &inst = inb->items[i];
+            RegVal value = inst.value;
+            for (unsigned s = 0; s < inst.numSrcs; s++) {
+                const RegVal src_value = ctx.regFile.getReg(inst.srcs[s]);
+                checksum += src_value;
+                if (inst.isMove)
+                    value = src_value;
+            }
+            reg_reads += inst.numSrcs;
+            if (!inst.eliminated) {
+                ctx.regFile.setReg(inst.dest, value);
+                reg_writes++;
+            }
+            outb->items[i] = inst.prevDest;
+        }
+        num_insts += inb->count;
+        outb->count = inb->count;
+        outb->last = last = inb->last;
+        in.pop();
+        freed.commitPush();
+    }
+
+    _stats.numInsts = num_insts;
+    _stats.regReads = reg_reads;
+    _stats.regWrites = reg_writes;
+    _stats.readChecksum = checksum;
+    _stats.writeInputEmpty = input_empty;
+}
+
+template <class Source>
+void
+ThreadedPipeline::runWith(Source &&next)
+{
+    SPSCQueue<RecordBatch> records(config.queueBatches);
+    SPSCQueue<RenamedBatch> renamed(config.queueBatches);
+    SPSCQueue<FreeBatch> freed(config.queueBatches);
+
+    _stats = ThreadedPipelineStats();
+    std::thread decoder([&]() { decodeStage(next, records); });
+    std::thread updater([&]() { updateStage(renamed, freed); });
+    renameStage(records, renamed, freed);
+    decoder.join();
+    updater.join();
+}
+
+void
+ThreadedPipeline::run(std::istream &trace)
+{
+    TraceReader reader(trace, ctx.regClass.numRegs());
+    runWith([&reader](TraceRecord &rec) { return reader.next(rec); });
+}
+
+void
+ThreadedPipeline::run(const TraceRecord *first, const TraceRecord *last)
+{
+    runWith([&first, last](TraceRecord &rec) {
+        if (first == last)
+            return false;
+        rec = *first++;
+        return true;
+    });
+}
+
+} // namespace workflow
@@ -0,0 +1,93 @@
+#ifndef __THREADED_PIPELINE_HH__
+#define __THREADED_PIPELINE_HH__
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+
+#include "pipeline.hh"
+#include "rename_sim.hh"
+#include "spsc_queue.hh"
+#include "trace.hh"
+
+namespace workflow
+{
+
+struct ThreadedPipelineConfig : PipelineBaseConfig
+{
+    /** Batches each inter-stage queue can hold. */
+    size_t queueBatches = 64;
+};
+
+struct ThreadedPipelineStats : PipelineBaseStats
+{
+    uint64_t numInsts = 0;
+
+    /** Times a stage found its output queue full. */
+    uint64_t decodeOutputFull = 0;
+    uint64_t renameOutputFull = 0;
+    /** Times rename ran out of free registers and waited for returns. */
+    uint64_t renameFreeListEmpty = 0;
+    /** Times a stage found its input queue empty. */
+    uint64_t renameInputEmpty = 0;
+    uint64_t writeInputEmpty = 0;
+
+    void print(std::ostream &os) const;
+};
+
+/**
+ * Runs trace decode, rename and register file update as three threads
+ * connected by SPSC queues of record batches:
+ *
+ *   decode --records--> rename --renamed--> update
+ *                         ^                    |
+ *                         +---freed registers--+
+ *
+ * Rename alone owns the RenameMap and free list; update alone writes the
+ * PhysRegFile and sends every previous mapping back once its instruction
+ * has been written. Results match a functional RenameSim replay.
+ */
+class ThreadedPipeline
+{
+  public:
+    static constexpr size_t BatchSize = 256;
+
+  private:
+    using RecordBatch = Batch<TraceRecord, BatchSize>;
+    using RenamedBatch = Batch<RenamedInst, BatchSize>;
+    using FreeBatch = Batch<PhysRegIdPtr, BatchSize>;
+
+    ThreadedPipelineConfig config;
+    RenameContext ctx;
+    ThreadedPipelineStats _stats;
+
+    /** Run with decode pulling records from next(rec). */
+    template <class Source>
+    void runWith(Source &&next);
+
+    template <class Source>
+    void decodeStage(Source &next, SPSCQueue<RecordBatch> &out);
+    void renameStage(SPSCQueue<RecordBatch> &in,
+                     SPSCQueue<RenamedBatch> &out,
+                     SPSCQueue<FreeBatch> &freed);
+    void updateStage(SPSCQueue<RenamedBatch> &in,
+                     SPSCQueue<FreeBatch> &freed);
+
+  public:
+    ThreadedPipeline(const RegClass &reg_class, unsigned num_phys_regs,
+                     const ThreadedPipelineConfig &config);
+
+    RenameContext &context() { return ctx; }
+
+    /** Decode and replay a text trace. */
+    void run(std::istream &trace);
+
+    /** Replay already decoded records. */
+    void run(const TraceRecord *first, const TraceRecord *last);
+
+    const ThreadedPipelineStats &stats() const { return _stats; }
+};
+
+} // namespace workflow
+
+#endif // __THREADED_PIPELINE_HH__
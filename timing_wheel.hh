@@ -0,0 +1,189 @@
+#ifndef __TIMING_WHEEL_HH__
+#define __TIMING_WHEEL_HH__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace workflow
+{
+
+/**
+ * Hierarchical timing wheel of events of type T, keyed by cycle.
+ *
+ * Level L has NumSlots slots, each covering SlotBits bits of the cycle
+ * number starting at bit L * SlotBits. An event goes to the level of the
+ * highest bit in which its cycle differs from the current one, in the
+ * slot named by its cycle's bits at that level. When the current cycle
+ * crosses into a slot of a higher level, that slot's events move down to
+ * lower levels; each event moves at most NumLevels times, so scheduling
+ * and servicing are O(1) per event. Events beyond the top level wait in
+ * an overflow list that is redistributed every Horizon cycles.
+ *
+ * Events live in a pooled node array linked by 32-bit indices, so the
+ * wheel does no allocation once the pool has grown to its peak size.
+ * Events due in the same cycle are serviced in the order scheduled.
+ */
+template <class T>
+class TimingWheel
+{
+  public:
+    using Cycle = uint64_t;
+
+    static constexpr unsigned SlotBits = 6;
+    static constexpr unsigned NumSlots = 1u << SlotBits;
+    static constexpr unsigned NumLevels = 4;
+    /** Cycles covered by the levels; further events overflow. */
+    static constexpr Cycle Horizon = Cycle(1) << (SlotBits * NumLevels);
+
+  private:
+    static constexpr uint32_t Nil = UINT32_MAX;
+
+    struct Node
+    {
+        Cycle when;
+        uint32_t next;
+        T event;
+    };
+
+    struct Slot
+    {
+        uint32_t head = Nil;
+        uint32_t tail = Nil;
+    };
+
+    std::vector<Node> nodes;
+    uint32_t freeNodes = Nil;
+    Slot slots[NumLevels][NumSlots];
+    Slot overflow;
+
+    Cycle _now = 0;
+    size_t count = 0;
+
+    uint32_t
+    allocNode()
+    {
+        if (freeNodes != Nil) {
+            const uint32_t n = freeNodes;
+            freeNodes = nodes[n].next;
+            return n;
+        }
+        nodes.emplace_back();
+        return nodes.size() - 1;
+    }
+
+    void
+    releaseNode(uint32_t n)
+    {
+        nodes[n].next = freeNodes;
+        freeNodes = n;
+    }
+
+    /** Append node n to the slot its cycle falls in. */
+    void
+    place(uint32_t n)
+    {
+        const Cycle diff = nodes[n].when ^ _now;
+        const unsigned level =
+            diff ? (63 - __builtin_clzll(diff)) / SlotBits : 0;
+        Slot &slot = level < NumLevels ?
+            slots[level][(nodes[n].when >> (level * SlotBits)) &
+                         (NumSlots - 1)] :
+            overflow;
+        nodes[n].next = Nil;
+        if (slot.tail == Nil)
+            slot.head = n;
+        else
+            nodes[slot.tail].next = n;
+        slot.tail = n;
+    }
+
+    /** Place the events of slot again, relative to the current cycle. */
+    void
+    cascade(Slot &slot)
+    {
+        uint32_t n = slot.head;
+        slot = Slot();
+        while (n != Nil) {
+            const uint32_t next = nodes[n].next;
+            place(n);
+            n = next;
+        }
+    }
+
+  public:
+    explicit TimingWheel(size_t reserve = 0) { nodes.reserve(reserve); }
+
+    Cycle now() const { return _now; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    /** Schedule event delay cycles from now; 0 means this cycle. */
+    void
+    schedule(Cycle delay, const T &event)
+    {
+        const uint32_t n = allocNode();
+        nodes[n].when = _now + delay;
+        nodes[n].event = event;
+        place(n);
+        count++;
+    }
+
+    /**
+     * Pass every event due this cycle to process, including any it
+     * schedules for this cycle itself.
+     */
+    template <class F>
+    void
+    service(F &&process)
+    {
+        Slot &slot = slots[0][_now & (NumSlots - 1)];
+        while (slot.head != Nil) {
+            const uint32_t n = slot.head;
+            slot.head = nodes[n].next;
+            if (slot.head == Nil)
+                slot.tail = Nil;
+            const T event = nodes[n].event;
+            releaseNode(n);
+            count--;
+            process(event);
+        }
+    }
+
+    /** Move to the next cycle; events due this cycle must be serviced. */
+    void
+    advance()
+    {
+        assert(slots[0][_now & (NumSlots - 1)].head == Nil);
+        _now++;
+        // Higher levels first, so their events can cascade further down.
+        if ((_now & (Horizon - 1)) == 0)
+            cascade(overflow);
+        for (unsigned level = NumLevels - 1; level > 0; level--) {
+            const Cycle low_mask = (Cycle(1) << (level * SlotBits)) - 1;
+            if ((_now & low_mask) == 0) {
+                cascade(slots[level][(_now >> (level * SlotBits)) &
+                                     (NumSlots - 1)]);
+            }
+        }
+    }
+
+    /** Drop every event and restart from cycle 0, keeping the pool. */
+    void
+    clear()
+    {
+        for (auto &level : slots)
+            for (Slot &slot : level)
+                slot = Slot();
+        overflow = Slot();
+        nodes.clear();
+        freeNodes = Nil;
+        _now = 0;
+        count = 0;
+    }
+};
+
+} // namespace workflow
+
+#endif // __TIMING_WHEEL_HH__
@@ -0,0 +1,174 @@
+#include "trace.hh"
+
+#include <cstdlib>
+#include <fstream>
+
+#include "capability.hh"
+#include "debug.hh"
+#include "intmath.hh"
+
+namespace workflow
+{
+
+namespace
+{
+
+/**
+ * Parse an architectural register index at line, advancing line past it.
+ * @return false if line holds no number; panics if the index is not
+ * below num_arch_regs.
+ */
+bool
+parseReg(const char *&line, unsigned num_arch_regs, uint64_t line_no,
+         RegIndex &reg)
+{
+    char *end;
+    // Range check before narrowing, so large indices cannot wrap.
+    const unsigned long idx = std::strtoul(line, &end, 0);
+    if (end == line)
+        return false;
+    if (idx >= num_arch_regs)
+        panic("Trace line %llu: register %lu out of range, %u "
+              "architectural registers\n", (unsigned long long)line_no,
+              idx, num_arch_regs);
+    reg = idx;
+    line = end;
+    return true;
+}
+
+} // anonymous namespace
+
+bool
+parseTraceLine(const char *line, TraceRecord &rec, unsigned num_arch_regs,
+               uint64_t line_no)
+{
+    const unsigned long long ln = line_no;
+    while (*line == ' ' || *line == '\t')
+        line++;
+    if (*line == '\0' || *line == '\n' || *line == '#')
+        return false;
+    if (*line != 'w' && *line != 'p' && *line != 'm')
+        panic("Trace line %llu: unknown record: %s\n", ln, line);
+    const char kind = *line++;
+    rec.isMove = kind == 'm';
+    rec.numPinnedWrites = 0;
+
+    char *end;
+    if (!parseReg(line, num_arch_regs, line_no, rec.dest))
+        panic("Trace line %llu: record without destination\n", ln);
+    if (kind == 'p') {
+        const unsigned long num_writes = std::strtoul(line, &end, 0);
+        if (end == line || num_writes == 0 ||
+            num_writes > TraceRecord::MaxPinnedWrites)
+            panic("Trace line %llu: pinned writes must be 1 to %u\n", ln,
+                  TraceRecord::MaxPinnedWrites);
+        rec.numPinnedWrites = num_writes;
+        line = end;
+    }
+    if (rec.isMove) {
+        if (!parseReg(line, num_arch_regs, line_no, rec.srcs[0]))
+            panic("Trace line %llu: move without source\n", ln);
+        rec.numSrcs = 1;
+        rec.value = 0;
+        return true;
+    }
+    rec.value = std::strtoull(line, &end, 0);
+    if (end == line)
+        panic("Trace line %llu: record without value\n", ln);
+    line = end;
+
+    rec.numSrcs = 0;
+    RegIndex src;
+    while (parseReg(line, num_arch_regs, line_no, src)) {
+        if (rec.numSrcs == TraceRecord::MaxSrcRegs)
+            panic("Trace line %llu: too many source registers\n", ln);
+        rec.srcs[rec.numSrcs++] = src;
+    }
+    return true;
+}
+
+bool
+TraceReader::next(TraceRecord &rec)
+{
+    while (std::getline(is, line)) {
+        lineNo++;
+        if (parseTraceLine(line.c_str(), rec, numArchRegs, lineNo))
+            return true;
+    }
+    return false;
+}
+
+void
+writeTraceRecord(std::ostream &os, const TraceRecord &rec)
+{
+    if (rec.isMove) {
+        os << "m " << rec.dest << ' ' << rec.srcs[0] << '\n';
+        return;
+    }
+    if (rec.numPinnedWrites)
+        os << "p " << rec.dest << ' ' << unsigned(rec.numPinnedWrites);
+    else
+        os << "w " << rec.dest;
+    os << " 0x" << std::hex << rec.value << std::dec;
+    for (unsigned i = 0; i < rec.numSrcs; i++)
+        os << ' ' << rec.srcs[i];
+    os << '\n';
+}
+
+void
+loadTrace(const std::string &path, unsigned num_arch_regs,
+          std::vector<TraceRecord> &trace)
+{
+    std::ifstream is(path);
+    if (!is)
+        panic("Cannot open trace %s\n", path.c_str());
+    TraceReader reader(is, num_arch_regs);
+    TraceRecord rec;
+    while (reader.next(rec))
+        trace.push_back(rec);
+}
+
+void
+generateTrace(std::vector<TraceRecord> &trace, size_t num_insts,
+              unsigned num_arch_regs, uint64_t seed, unsigned move_percent,
+              unsigned pin_percent)
+{
+    uint64_t state = seed ? seed : 1;
+    auto rand = [&state]() { return xorshift64(state); };
+
+    // Writes of each register still to reuse its pinned register.
+    std::vector<uint8_t> pinned(pin_percent ? num_arch_regs : 0, 0);
+    auto is_pinned = [&pinned](RegIndex reg) {
+        return !pinned.empty() && pinned[reg];
+    };
+
+    trace.reserve(trace.size() + num_insts);
+    for (size_t i = 0; i < num_insts; i++) {
+        TraceRecord rec;
+        rec.dest = rand() % num_arch_regs;
+        // Draw only if moves are wanted, so other traces stay the same.
+        if (move_percent && rand() % 100 < move_percent) {
+            const RegIndex src = rand() % num_arch_regs;
+            if (!is_pinned(rec.dest) && !is_pinned(src)) {
+                rec.isMove = true;
+                rec.numSrcs = 1;
+                rec.srcs[0] = src;
+                trace.push_back(rec);
+                continue;
+            }
+        }
+        rec.numSrcs = rand() % (TraceRecord::MaxSrcRegs + 1);
+        for (unsigned s = 0; s < rec.numSrcs; s++)
+            rec.srcs[s] = rand() % num_arch_regs;
+        rec.value = constructCapability(rand() % 512);
+        if (is_pinned(rec.dest)) {
+            pinned[rec.dest]--;
+        } else if (pin_percent && rand() % 100 < pin_percent) {
+            rec.numPinnedWrites = 1 + rand() % 3;
+            pinned[rec.dest] = rec.numPinnedWrites;
+        }
+        trace.push_back(rec);
+    }
+}
+
+} // namespace workflow
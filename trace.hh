@@ -0,0 +1,100 @@
+#ifndef __TRACE_HH__
+#define __TRACE_HH__
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "reg_class.hh"
+
+namespace workflow
+{
+
+/**
+ * One instruction of a rename trace: it reads up to MaxSrcRegs
+ * architectural capability registers and writes value to dest.
+ *
+ * A move copies the value of its one source to dest instead, and its
+ * value field is unused.
+ *
+ * A write may pin the register it renames dest to for numPinnedWrites
+ * further writes of dest, which then reuse it instead of allocating;
+ * see PinnedWrites. Moves never pin.
+ *
+ * Text form, one record per line ('#' starts a comment):
+ *     w <dest> <value> [<src> ...]
+ *     p <dest> <pinned writes> <value> [<src> ...]
+ *     m <dest> <src>
+ * Numbers accept a 0x prefix for hexadecimal.
+ */
+struct TraceRecord
+{
+    static constexpr unsigned MaxSrcRegs = 2;
+    static constexpr unsigned MaxPinnedWrites = 127;
+
+    RegIndex dest = 0;
+    uint8_t numSrcs = 0;
+    // Bit-fields, to keep a record in 16 bytes.
+    bool isMove : 1;
+    uint8_t numPinnedWrites : 7;
+    RegIndex srcs[MaxSrcRegs] = {};
+    RegVal value = 0;
+
+    TraceRecord() : isMove(false), numPinnedWrites(0) {}
+};
+
+/** Streams records out of a text trace without holding it in memory. */
+class TraceReader
+{
+  private:
+    std::istream &is;
+    const unsigned numArchRegs;
+    std::string line;
+    uint64_t lineNo = 0;
+
+  public:
+    /** Registers must be below num_arch_regs. */
+    TraceReader(std::istream &_is, unsigned num_arch_regs)
+        : is(_is), numArchRegs(num_arch_regs)
+    {}
+
+    /**
+     * Decode the next record.
+     * @return false at the end of the trace.
+     */
+    bool next(TraceRecord &rec);
+
+    uint64_t lineNumber() const { return lineNo; }
+};
+
+/**
+ * Decode line line_no of a text trace over num_arch_regs registers.
+ * @return false if the line holds no record (blank or comment); panics
+ * with the line number on malformed input or an out-of-range register.
+ */
+bool parseTraceLine(const char *line, TraceRecord &rec,
+                    unsigned num_arch_regs, uint64_t line_no);
+
+/** Write rec in the text form read by TraceReader. */
+void writeTraceRecord(std::ostream &os, const TraceRecord &rec);
+
+/** Read a whole trace file over num_arch_regs registers into memory. */
+void loadTrace(const std::string &path, unsigned num_arch_regs,
+               std::vector<TraceRecord> &trace);
+
+/**
+ * Append num_insts pseudo-random records over num_arch_regs registers,
+ * writing capabilities for random L1 lines, of which about move_percent
+ * percent are moves. About pin_percent percent of the writes to a
+ * register not already pinned pin it for 1 to 3 further writes; moves
+ * neither read nor write a pinned register. Deterministic for a seed.
+ */
+void generateTrace(std::vector<TraceRecord> &trace, size_t num_insts,
+                   unsigned num_arch_regs, uint64_t seed,
+                   unsigned move_percent = 0, unsigned pin_percent = 0);
+
+} // namespace workflow
+
+#endif // __TRACE_HH__